@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "include/Checkpoint.hpp"
+
+static const char CHECKPOINT_FILE_MAGIC[4] = {'T', 'M', 'S', '\n'};
+static const uint32_t CHECKPOINT_FILE_VERSION = 2;
+static const uint32_t CHECKPOINT_FILE_BYTE_ORDER = 0x01020304;
+
+static_assert(sizeof(CheckpointHeader) <= CheckpointWriter::PAGE, "The checkpoint header has to fit into a page");
+
+/*
+ * Layout of journals: the header of the new checkpoint, the number of pages,
+ * the pages each with their index in front, and a hash of everything before,
+ * which tells complete journals from torn ones.
+ */
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t fnv(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for(size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * FNV_PRIME;
+	return hash;
+}
+
+uint64_t machineHash(const CompiledMachine& machine) {
+	uint64_t hash = FNV_OFFSET;
+	uint32_t start = machine.startState();
+	hash = fnv(hash, &start, sizeof(start));
+	hash = fnv(hash, &machine.lookup(0, 0), sizeof(Transition) * machine.stateCount() * CompiledMachine::SYMBOLS);
+	for(uint32_t state = 0; state < machine.stateCount(); state++) {
+		std::string_view name = machine.stateName(state);
+		hash = fnv(hash, name.data(), name.size());
+		hash = fnv(hash, "", 1);
+	}
+	return hash;
+}
+
+static std::string journalName(const std::string& filename) {
+	return filename + ".journal";
+}
+
+// write a whole buffer at an offset of a file
+static bool writeAt(int descriptor, const char* data, size_t size, uint64_t offset) {
+	while(size > 0) {
+		ssize_t written = pwrite(descriptor, data, size, offset);
+		if(written <= 0)
+			return false;
+		data += written;
+		size -= written;
+		offset += written;
+	}
+	return true;
+}
+
+static const size_t JOURNAL_RECORD_BYTES = sizeof(uint64_t) + CheckpointWriter::PAGE;
+
+// a journal is torn if the process was killed while writing it
+static bool journalComplete(const char* journal, size_t size) {
+	uint64_t pages, hash;
+	if(size < sizeof(CheckpointHeader) + 2 * sizeof(uint64_t))
+		return false;
+	memcpy(&pages, journal + sizeof(CheckpointHeader), sizeof(pages));
+	if(pages > size / JOURNAL_RECORD_BYTES
+		|| size != sizeof(CheckpointHeader) + 2 * sizeof(uint64_t) + pages * JOURNAL_RECORD_BYTES)
+		return false;
+	memcpy(&hash, journal + size - sizeof(hash), sizeof(hash));
+	return fnv(FNV_OFFSET, journal, size - sizeof(hash)) == hash;
+}
+
+/**
+ * Copy the pages of a complete journal into its checkpoint file and remove the journal.
+ *
+ * @return false if the file could not be written
+ */
+static bool applyJournal(const std::string& filename, const char* journal) {
+	uint64_t pages;
+	memcpy(&pages, journal + sizeof(CheckpointHeader), sizeof(pages));
+
+	CheckpointHeader header;
+	memcpy(&header, journal, sizeof(header));
+
+	int descriptor = open(filename.c_str(), O_WRONLY);
+	if(descriptor < 0)
+		return false;
+
+	// the pages first, so the header only changes once they are in place
+	bool written = true;
+	const char* record = journal + sizeof(CheckpointHeader) + sizeof(uint64_t);
+	for(uint64_t i = 0; i < pages && written; i++, record += JOURNAL_RECORD_BYTES) {
+		uint64_t page;
+		memcpy(&page, record, sizeof(page));
+		uint64_t first = page * CheckpointWriter::PAGE;
+		if(first >= header.length)
+			continue;
+		written = writeAt(descriptor, record + sizeof(page),
+			std::min<uint64_t>(CheckpointWriter::PAGE, header.length - first), CheckpointWriter::PAGE + first);
+	}
+	written = written && writeAt(descriptor, journal, sizeof(header), 0) && fsync(descriptor) == 0;
+	close(descriptor);
+
+	return written && unlink(journalName(filename).c_str()) == 0;
+}
+
+static CheckpointHeader makeHeader(uint64_t machine, const Tape* tape, uint32_t state, uint64_t steps) {
+	CheckpointHeader header = {};
+	memcpy(header.magic, CHECKPOINT_FILE_MAGIC, sizeof(header.magic));
+	header.version = CHECKPOINT_FILE_VERSION;
+	header.byteOrder = CHECKPOINT_FILE_BYTE_ORDER;
+	header.state = state;
+	header.machine = machine;
+	header.steps = steps;
+	header.length = tape->length;
+	header.head = tape->currentPos;
+	header.origin = tape->origin;
+	return header;
+}
+
+bool CheckpointWriter::open(const std::string& filename, double interval, const CompiledMachine& machine,
+														const Tape* tape, uint32_t state, uint64_t steps) {
+	this->filename = filename;
+	this->machine = machineHash(machine);
+	this->interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(interval));
+	this->next = std::chrono::steady_clock::now() + this->interval;
+
+	if(!this->writeAll(tape, state, steps)) {
+		std::cout << "Unable to write '" << filename << "'" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool CheckpointWriter::save(const Tape* tape, uint32_t state, uint64_t steps) {
+	this->next = std::chrono::steady_clock::now() + this->interval;
+
+	// a tape that grew has moved its cells, so every page is new
+	bool saved = tape->length == this->length ? this->writeDirty(tape, state, steps)
+		: this->writeAll(tape, state, steps);
+	if(!saved)
+		std::cout << "Unable to write '" << this->filename << "'" << std::endl;
+	return saved;
+}
+
+bool CheckpointWriter::writeAll(const Tape* tape, uint32_t state, uint64_t steps) {
+	// a journal left over belongs to the file that is about to be replaced
+	unlink(journalName(this->filename).c_str());
+
+	std::string temporary = this->filename + ".tmp";
+	int descriptor = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(descriptor < 0)
+		return false;
+
+	std::vector<char> page(PAGE, 0);
+	CheckpointHeader header = makeHeader(this->machine, tape, state, steps);
+	memcpy(page.data(), &header, sizeof(header));
+
+	bool written = writeAt(descriptor, page.data(), PAGE, 0)
+		&& writeAt(descriptor, tape->data, tape->length, PAGE) && fsync(descriptor) == 0;
+	close(descriptor);
+
+	// the old checkpoint stays in place until the new one is complete
+	if(!written || rename(temporary.c_str(), this->filename.c_str()) != 0) {
+		unlink(temporary.c_str());
+		return false;
+	}
+
+	this->length = tape->length;
+	this->dirty.assign((this->length + PAGE - 1) / PAGE, false);
+	return true;
+}
+
+bool CheckpointWriter::writeDirty(const Tape* tape, uint32_t state, uint64_t steps) {
+	std::string journal;
+	CheckpointHeader header = makeHeader(this->machine, tape, state, steps);
+	journal.append(reinterpret_cast<const char*>(&header), sizeof(header));
+	journal.append(sizeof(uint64_t), '\0');
+
+	uint64_t pages = 0;
+	for(uint64_t page = 0; page < this->dirty.size(); page++) {
+		if(!this->dirty[page])
+			continue;
+
+		// the last page of the tape is padded
+		uint64_t first = page * PAGE;
+		uint64_t bytes = std::min<uint64_t>(PAGE, this->length - first);
+		journal.append(reinterpret_cast<const char*>(&page), sizeof(page));
+		journal.append(tape->data + first, bytes);
+		journal.append(PAGE - bytes, '\0');
+		pages++;
+	}
+	memcpy(&journal[sizeof(header)], &pages, sizeof(pages));
+	uint64_t hash = fnv(FNV_OFFSET, journal.data(), journal.size());
+	journal.append(reinterpret_cast<const char*>(&hash), sizeof(hash));
+
+	// once the journal is on disk, the checkpoint can be completed even after a crash
+	int descriptor = ::open(journalName(this->filename).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(descriptor < 0)
+		return false;
+	bool written = writeAt(descriptor, journal.data(), journal.size(), 0) && fsync(descriptor) == 0;
+	close(descriptor);
+
+	if(!written || !applyJournal(this->filename, journal.data()))
+		return false;
+
+	this->dirty.assign(this->dirty.size(), false);
+	return true;
+}
+
+bool Checkpoint::open(const std::string& filename, const CompiledMachine& machine) {
+	// finish the last checkpoint if the process was killed after writing its journal
+	if(access(journalName(filename).c_str(), F_OK) == 0) {
+		MappedFile journal;
+		if(!journal.open(journalName(filename)))
+			return false;
+		if(!journalComplete(journal.data(), journal.size()))
+			unlink(journalName(filename).c_str());
+		else if(!applyJournal(filename, journal.data())) {
+			std::cout << "Unable to complete the last checkpoint in '" << filename << "'" << std::endl;
+			return false;
+		}
+	}
+
+	if(!this->file.open(filename))
+		return false;
+	this->filename = filename;
+
+	if(this->file.size() < CheckpointWriter::PAGE) {
+		std::cout << "'" << filename << "' is not a checkpoint" << std::endl;
+		return false;
+	}
+	this->header = reinterpret_cast<const CheckpointHeader*>(this->file.data());
+
+	if(memcmp(this->header->magic, CHECKPOINT_FILE_MAGIC, sizeof(this->header->magic)) != 0) {
+		std::cout << "'" << filename << "' is not a checkpoint" << std::endl;
+		return false;
+	}
+	if(this->header->version != CHECKPOINT_FILE_VERSION || this->header->byteOrder != CHECKPOINT_FILE_BYTE_ORDER) {
+		std::cout << "'" << filename << "' was written by an incompatible version or machine" << std::endl;
+		return false;
+	}
+	if(this->header->machine != machineHash(machine)) {
+		std::cout << "'" << filename << "' was written by another Turing Machine" << std::endl;
+		return false;
+	}
+	if(this->file.size() < CheckpointWriter::PAGE + static_cast<uint64_t>(this->header->length)
+		|| this->header->head >= this->header->length || this->header->origin > this->header->length
+		|| this->header->state >= machine.stateCount()) {
+		std::cout << "'" << filename << "' is damaged" << std::endl;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,570 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "include/Checkpoint.hpp"
+#include "include/CompiledMachine.hpp"
+#include "include/CycleDetector.hpp"
+#include "include/DebugView.hpp"
+#include "include/Debugger.hpp"
+#include "include/PackedTape.hpp"
+#include "include/Profiler.hpp"
+#include "include/RunLengthTape.hpp"
+#include "include/Tape.hpp"
+#include "include/TraceRecorder.hpp"
+
+// number of steps between two checks of the run limits
+#define CHECK_INTERVAL	4096
+
+bool CompiledMachine::run(Tape* tape, bool showDebug) const {
+	RunOptions options;
+	options.showDebug = showDebug;
+
+	return this->run(tape, options).accepted;
+}
+
+/*
+ * Helpers to let the execution loop work on different kinds of tapes.
+ */
+
+// plain and packed tapes search their cells for the cell where a sweep or scan ends
+template<class TapeType>
+static inline uint64_t sweep(TapeType* tape, const Transition& transition, uint64_t limit) {
+	if(transition.kind == TransitionKind::SCAN) {
+		if(transition.direction == Direction::LEFT)
+			return tape->scanLeft(transition.stopSymbol, limit);
+		return tape->scanRight(transition.stopSymbol, limit);
+	}
+
+	if(transition.direction == Direction::LEFT)
+		return tape->sweepLeft(limit);
+	return tape->sweepRight(limit);
+}
+
+// cross the rest of the run under the head in a single operation
+static inline uint64_t sweep(RunLengthTape* tape, const Transition& transition, uint64_t limit) {
+	uint64_t cells;
+	if(transition.direction == Direction::LEFT) {
+		cells = std::min(tape->remainingLeft(), limit);
+		tape->skipLeft(cells);
+	} else {
+		cells = std::min(tape->remainingRight(), limit);
+		tape->skipRight(cells);
+	}
+	return cells;
+}
+
+static inline uint64_t tapeSize(const Tape* tape) {
+	return tape->length;
+}
+
+template<class TapeType>
+static inline uint64_t tapeSize(const TapeType* tape) {
+	return tape->size();
+}
+
+// the state a run starts in, which is not the start state when it is resumed or continued
+static inline uint32_t firstState(const CompiledMachine& machine, const RunOptions& options) {
+	if(options.proceed != nullptr)
+		return options.proceed->state;
+	return options.resume != nullptr ? options.resume->state() : machine.startState();
+}
+
+// only plain tapes can be saved in checkpoints
+static inline bool openCheckpoint(CheckpointWriter& writer, const CompiledMachine& machine, const Tape* tape,
+																	const RunOptions& options, uint32_t state, uint64_t steps) {
+	return writer.open(options.checkpointFile, options.checkpointInterval, machine, tape, state, steps);
+}
+
+template<class TapeType>
+static inline bool openCheckpoint(CheckpointWriter&, const CompiledMachine&, const TapeType*,
+																	const RunOptions&, uint32_t, uint64_t) {
+	return false;
+}
+
+static inline void afterBlock(CheckpointWriter& writer, const Tape* tape, uint32_t state, uint64_t steps,
+															uint64_t moved) {
+	writer.afterBlock(tape, state, steps, moved);
+}
+
+template<class TapeType>
+static inline void afterBlock(CheckpointWriter&, const TapeType*, uint32_t, uint64_t, uint64_t) {
+}
+
+static inline void saveCheckpoint(CheckpointWriter& writer, const Tape* tape, uint32_t state, uint64_t steps) {
+	writer.save(tape, state, steps);
+}
+
+template<class TapeType>
+static inline void saveCheckpoint(CheckpointWriter&, const TapeType*, uint32_t, uint64_t) {
+}
+
+/*
+ * Observers get to see every single step of a run and may stop it. A run
+ * with an observer does not sweep across runs of symbols, so the common
+ * case of running without one pays nothing for them.
+ */
+struct NoObserver {
+	static const bool EACH_STEP = false;
+
+	template<class TapeType>
+	bool afterStep(const TapeType*, uint32_t, char, const Transition&) {
+		return true;
+	}
+
+	HaltReason stopReason() const {
+		return HaltReason::HALTED;
+	}
+};
+
+// two observers watching the same run, which stops as soon as one of them stops it
+template<class First, class Second>
+struct ObserverPair {
+	static const bool EACH_STEP = First::EACH_STEP || Second::EACH_STEP;
+
+	First& first;
+	Second& second;
+	bool firstStopped = false;
+
+	template<class TapeType>
+	bool afterStep(const TapeType* tape, uint32_t state, char read, const Transition& transition) {
+		if(!this->first.afterStep(tape, state, read, transition)) {
+			this->firstStopped = true;
+			return false;
+		}
+		return this->second.afterStep(tape, state, read, transition);
+	}
+
+	HaltReason stopReason() const {
+		return this->firstStopped ? this->first.stopReason() : this->second.stopReason();
+	}
+};
+
+template<class TapeType, class Observer>
+static RunResult execute(const CompiledMachine& machine, TapeType* tape, const RunOptions& options,
+												Observer& observer) {
+
+	auto startTime = std::chrono::steady_clock::now();
+	bool checkDeadline = options.deadline != std::chrono::steady_clock::time_point::max();
+	bool sweeping = !Observer::EACH_STEP && !options.showDebug;
+
+	RunResult result;
+	uint32_t currentState = firstState(machine, options);
+	if(options.resume != nullptr)
+		result.steps = options.resume->steps();
+	if(options.proceed != nullptr)
+		result.steps = options.proceed->steps;
+
+	CheckpointWriter checkpoint;
+	bool checkpointing = !options.checkpointFile.empty()
+		&& openCheckpoint(checkpoint, machine, tape, options, currentState, result.steps);
+
+	DebugView<CompiledMachine> view(machine, options);
+	if(options.showDebug)
+		view.show(tape, currentState, 0);
+
+	while(true) {
+		// execute a block of steps without looking at the limits
+		uint64_t block = CHECK_INTERVAL;
+		if(options.maxSteps != 0) {
+			if(result.steps >= options.maxSteps) {
+				result.reason = HaltReason::STEP_LIMIT;
+				break;
+			}
+			if(options.maxSteps - result.steps < block)
+				block = options.maxSteps - result.steps;
+		}
+
+		uint64_t done = 0;
+		bool halted = false, stopped = false;
+		while(done < block) {
+			char symbol = tape->getSymbol();
+			const Transition& transition = machine.lookup(currentState, symbol);
+			if(transition.kind == TransitionKind::HALT) {
+				halted = true;
+				break;
+			}
+
+			uint64_t swept = 0;
+			if(sweeping && transition.kind >= TransitionKind::SWEEP)
+				swept = sweep(tape, transition, block - done);
+
+			if(swept != 0) {
+				done += swept;
+			} else {
+				// apply the rule
+				tape->putSymbol(transition.writeSymbol);
+
+				if(transition.direction == Direction::LEFT)
+					tape->stepLeft();
+				else if(transition.direction == Direction::RIGHT)
+					tape->stepRight();
+
+				currentState = transition.target;
+				done++;
+
+				if(Observer::EACH_STEP && !observer.afterStep(tape, currentState, symbol, transition)) {
+					stopped = true;
+					break;
+				}
+			}
+
+			// show the current state (tape)
+			if(options.showDebug)
+				view.afterStep(tape, currentState, result.steps + done);
+		}
+		result.steps += done;
+
+		if(checkpointing)
+			afterBlock(checkpoint, tape, currentState, result.steps, done);
+
+		if(halted)
+			break;
+
+		if(stopped) {
+			result.reason = observer.stopReason();
+			break;
+		}
+
+		if(options.maxTapeCells != 0 && tapeSize(tape) > options.maxTapeCells) {
+			result.reason = HaltReason::TAPE_LIMIT;
+			break;
+		}
+
+		if(checkDeadline && std::chrono::steady_clock::now() >= options.deadline) {
+			result.reason = HaltReason::TIMEOUT;
+			break;
+		}
+	}
+
+	// the run can be continued from where it stopped
+	if(checkpointing)
+		saveCheckpoint(checkpoint, tape, currentState, result.steps);
+
+	if(options.showDebug)
+		view.finish(tape, currentState, result.steps);
+
+	result.state = currentState;
+	result.accepted = result.reason == HaltReason::HALTED && machine.isFinal(currentState);
+	result.peakTapeSize = tapeSize(tape);
+	result.elapsed = std::chrono::steady_clock::now() - startTime;
+
+	return result;
+}
+
+// add the cycle detector to the observers of a run if it is wanted, and run
+template<class Observer>
+static RunResult observeCycles(const CompiledMachine& machine, Tape* tape, const RunOptions& options,
+												Observer& observer) {
+	if(!options.detectCycles)
+		return execute(machine, tape, options, observer);
+
+	CycleDetector cycles(tape, firstState(machine, options));
+	ObserverPair<Observer, CycleDetector> both{observer, cycles};
+	return execute(machine, tape, options, both);
+}
+
+// the same for the trace recorder, which sees the last step before the cycle detector stops a run
+template<class Observer>
+static RunResult observeTrace(const CompiledMachine& machine, Tape* tape, const RunOptions& options,
+												Observer& observer) {
+	// the trace is complete once the recorder goes out of scope
+	TraceRecorder trace;
+	if(options.traceFile.empty() || options.resume != nullptr || options.proceed != nullptr
+		|| !trace.open(options.traceFile, machine, tape))
+		return observeCycles(machine, tape, options, observer);
+
+	ObserverPair<Observer, TraceRecorder> both{observer, trace};
+	return observeCycles(machine, tape, options, both);
+}
+
+RunResult CompiledMachine::run(Tape* tape, const RunOptions& options) const {
+	if(options.watch != nullptr)
+		return observeTrace(*this, tape, options, *options.watch);
+	if(options.profile != nullptr)
+		return observeTrace(*this, tape, options, *options.profile);
+
+	NoObserver none;
+	return observeTrace(*this, tape, options, none);
+}
+
+RunResult CompiledMachine::run(RunLengthTape* tape, const RunOptions& options) const {
+	NoObserver none;
+	return execute(*this, tape, options, none);
+}
+
+template<unsigned BITS>
+RunResult CompiledMachine::run(PackedTape<BITS>* tape, const RunOptions& options) const {
+	NoObserver none;
+	return execute(*this, tape, options, none);
+}
+
+template RunResult CompiledMachine::run(PackedTape<1>*, const RunOptions&) const;
+template RunResult CompiledMachine::run(PackedTape<2>*, const RunOptions&) const;
+template RunResult CompiledMachine::run(PackedTape<4>*, const RunOptions&) const;
+
+RunResult CompiledMachine::runPacked(const char* input, const RunOptions& options) const {
+	SymbolAlphabet alphabet(this->alphabet() + input);
+	switch(alphabet.bitsPerCell()) {
+	case 1: {
+		PackedTape<1> tape(input, alphabet);
+		return this->run(&tape, options);
+	}
+	case 2: {
+		PackedTape<2> tape(input, alphabet);
+		return this->run(&tape, options);
+	}
+	case 4: {
+		PackedTape<4> tape(input, alphabet);
+		return this->run(&tape, options);
+	}
+	default: {
+		Tape tape(input);
+		return this->run(&tape, options);
+	}
+	}
+}
+
+std::string CompiledMachine::alphabet() const {
+	std::string symbols;
+	for(uint32_t symbol = 0; symbol < SYMBOLS; symbol++) {
+		if(this->symbolUses[symbol] != 0 && static_cast<char>(symbol) != Tape::EMPTY_SYMBOL)
+			symbols += static_cast<char>(symbol);
+	}
+	return symbols;
+}
+
+void CompiledMachine::countSymbols() {
+	this->symbolUses.fill(0);
+	for(uint64_t i = 0; i < static_cast<uint64_t>(this->states) * SYMBOLS; i++)
+		this->countSymbols(i, 1);
+}
+
+void CompiledMachine::countSymbols(uint64_t entry, int64_t uses) {
+	const Transition& transition = this->table[entry];
+	if(transition.kind == TransitionKind::HALT)
+		return;
+
+	// scans move over every symbol without writing, only their stop symbol matters
+	if(transition.kind == TransitionKind::SCAN) {
+		this->symbolUses[static_cast<unsigned char>(transition.stopSymbol)] += uses;
+		return;
+	}
+	this->symbolUses[entry % SYMBOLS] += uses;
+	this->symbolUses[static_cast<unsigned char>(transition.writeSymbol)] += uses;
+}
+
+bool CompiledMachine::step(Tape* tape) const {
+	return this->step(tape, RunOptions());
+}
+
+bool CompiledMachine::step(Tape* tape, const RunOptions& options) const {
+
+	uint32_t currentState = this->start;
+	uint64_t steps = 0;
+
+	DebugView<CompiledMachine> view(*this, options);
+	view.show(tape, currentState, steps);
+
+	while(true) {
+		// wait for user input
+		std::cin.get();
+
+		// execute as many steps as are shown at once
+		uint64_t count = std::max<uint64_t>(options.debugInterval, 1);
+		for(uint64_t i = 0; i < count; i++) {
+			const Transition& transition = this->lookup(currentState, tape->getSymbol());
+			if(transition.kind == TransitionKind::HALT) {
+				if(i > 0)
+					view.show(tape, currentState, steps);
+				return this->isFinal(currentState);
+			}
+
+			// apply the rule
+			tape->putSymbol(transition.writeSymbol);
+
+			if(transition.direction == Direction::LEFT)
+				tape->stepLeft();
+			else if(transition.direction == Direction::RIGHT)
+				tape->stepRight();
+
+			currentState = transition.target;
+			steps++;
+		}
+
+		// show the current state (tape)
+		view.show(tape, currentState, steps);
+	}
+}
+
+void CompiledMachine::reset(uint32_t states, uint32_t start) {
+	this->file.reset();
+	this->tableData.assign(static_cast<size_t>(states) * SYMBOLS, Transition{0, 0, 0, TransitionKind::HALT, 0});
+	this->finalStateData.assign(states, 0);
+	this->nameOffsetData.assign(1, 0);
+	this->nameData.clear();
+
+	for(uint32_t state = 0; state < states; state++) {
+		std::string name = state < 26 ? std::string(1, static_cast<char>('A' + state)) : "Q" + std::to_string(state);
+		this->nameData.insert(this->nameData.end(), name.begin(), name.end());
+		this->nameOffsetData.push_back(this->nameData.size());
+	}
+
+	this->useStorage();
+	this->start = start;
+}
+
+void CompiledMachine::setTransition(uint32_t state, char symbol, char writeSymbol, Direction direction,
+																		uint32_t target) {
+	// rules that just move on in the same state can be applied to whole runs, see TuringMachine::compile()
+	bool sweep = target == state && writeSymbol == symbol && direction != Direction::STAND;
+	this->setTransition(state, symbol, {
+		target, writeSymbol, static_cast<uint8_t>(direction), sweep ? TransitionKind::SWEEP : TransitionKind::MOVE, 0
+	});
+}
+
+void CompiledMachine::setTransition(uint32_t state, char symbol, const Transition& transition) {
+	uint64_t entry = static_cast<uint64_t>(state) * SYMBOLS + static_cast<unsigned char>(symbol);
+	this->countSymbols(entry, -1);
+	this->tableData[entry] = transition;
+	this->countSymbols(entry, 1);
+}
+
+void CompiledMachine::clearTransition(uint32_t state, char symbol) {
+	this->setTransition(state, symbol, {0, 0, 0, TransitionKind::HALT, 0});
+}
+
+void CompiledMachine::copy(const CompiledMachine& other) {
+	this->file.reset();
+	this->tableData.assign(other.table, other.table + static_cast<size_t>(other.states) * SYMBOLS);
+	this->finalStateData.assign(other.finalStates, other.finalStates + other.states);
+	this->nameOffsetData.assign(other.nameOffsets, other.nameOffsets + other.states + 1);
+	this->nameData.assign(other.names, other.names + other.nameOffsets[other.states]);
+
+	this->useStorage();
+	this->start = other.start;
+}
+
+/*
+ * Layout of machine files: the header, the transition table, the offsets of
+ * the state names, the final states and the names, without any separators.
+ * All numbers are stored in the byte order of the machine that wrote them.
+ */
+struct MachineFileHeader {
+	char magic[4];
+	uint32_t version;
+	// tells apart files from machines with another byte order
+	uint32_t byteOrder;
+	uint32_t states;
+	uint32_t start;
+	uint32_t reserved;
+	uint64_t nameBytes;
+};
+
+static const char MACHINE_FILE_MAGIC[4] = {'T', 'M', 'B', '\n'};
+static const uint32_t MACHINE_FILE_VERSION = 1;
+static const uint32_t MACHINE_FILE_BYTE_ORDER = 0x01020304;
+
+void CompiledMachine::useStorage() {
+	this->table = this->tableData.data();
+	this->finalStates = this->finalStateData.data();
+	this->nameOffsets = this->nameOffsetData.data();
+	this->names = this->nameData.data();
+	this->states = this->finalStateData.size();
+	this->countSymbols();
+}
+
+bool CompiledMachine::save(const std::string& filename) const {
+	MachineFileHeader header = {};
+	memcpy(header.magic, MACHINE_FILE_MAGIC, sizeof(header.magic));
+	header.version = MACHINE_FILE_VERSION;
+	header.byteOrder = MACHINE_FILE_BYTE_ORDER;
+	header.states = this->states;
+	header.start = this->start;
+	header.nameBytes = this->nameOffsets[this->states];
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(this->table),
+						sizeof(Transition) * this->states * SYMBOLS);
+	file.write(reinterpret_cast<const char*>(this->nameOffsets), sizeof(uint32_t) * (this->states + 1));
+	file.write(reinterpret_cast<const char*>(this->finalStates), this->states);
+	file.write(this->names, header.nameBytes);
+
+	if(!file) {
+		std::cout << "Unable to write '" << filename << "'" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool CompiledMachine::load(const std::string& filename) {
+	auto mapped = std::make_unique<MappedFile>();
+	if(!mapped->open(filename))
+		return false;
+
+	// check the header
+	MachineFileHeader header;
+	if(mapped->size() < sizeof(header)) {
+		std::cout << "'" << filename << "' is not a compiled machine" << std::endl;
+		return false;
+	}
+	memcpy(&header, mapped->data(), sizeof(header));
+
+	if(memcmp(header.magic, MACHINE_FILE_MAGIC, sizeof(header.magic)) != 0) {
+		std::cout << "'" << filename << "' is not a compiled machine" << std::endl;
+		return false;
+	}
+	if(header.version != MACHINE_FILE_VERSION || header.byteOrder != MACHINE_FILE_BYTE_ORDER) {
+		std::cout << "'" << filename << "' was written by an incompatible version or machine" << std::endl;
+		return false;
+	}
+
+	// the sections follow one another; the table stays aligned after the header
+	uint64_t tableBytes = sizeof(Transition) * static_cast<uint64_t>(header.states) * SYMBOLS;
+	uint64_t offsetBytes = sizeof(uint32_t) * (static_cast<uint64_t>(header.states) + 1);
+	uint64_t expected = sizeof(header) + tableBytes + offsetBytes + header.states + header.nameBytes;
+	if(header.states == 0 || header.start >= header.states || mapped->size() != expected) {
+		std::cout << "'" << filename << "' is damaged" << std::endl;
+		return false;
+	}
+
+	const char* data = mapped->data() + sizeof(header);
+	const Transition* table = reinterpret_cast<const Transition*>(data);
+	const uint32_t* nameOffsets = reinterpret_cast<const uint32_t*>(data + tableBytes);
+	const uint8_t* finalStates = reinterpret_cast<const uint8_t*>(data + tableBytes + offsetBytes);
+	const char* names = data + tableBytes + offsetBytes + header.states;
+
+	// a damaged table would make the machine leave its table while running
+	for(uint64_t i = 0; i < static_cast<uint64_t>(header.states) * SYMBOLS; i++) {
+		if(table[i].kind > TransitionKind::SCAN || table[i].direction > Direction::STAND
+			|| (table[i].kind != TransitionKind::HALT && table[i].target >= header.states)) {
+			std::cout << "'" << filename << "' is damaged" << std::endl;
+			return false;
+		}
+	}
+	for(uint32_t state = 0; state < header.states; state++) {
+		if(nameOffsets[state] > nameOffsets[state + 1] || nameOffsets[state + 1] > header.nameBytes) {
+			std::cout << "'" << filename << "' is damaged" << std::endl;
+			return false;
+		}
+	}
+
+	// use the file in place of the storage
+	this->tableData.clear();
+	this->finalStateData.clear();
+	this->nameOffsetData.clear();
+	this->nameData.clear();
+
+	this->table = table;
+	this->finalStates = finalStates;
+	this->nameOffsets = nameOffsets;
+	this->names = names;
+	this->states = header.states;
+	this->start = header.start;
+	this->file = std::move(mapped);
+	this->countSymbols();
+
+	return true;
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+
+#include "include/CycleDetector.hpp"
+#include "include/Tape.hpp"
+
+// base of the rolling hash over the tape and its inverse modulo 2^64
+static const uint64_t BASE = 0x9E3779B97F4A7C15ull;
+
+static uint64_t inverse(uint64_t value) {
+	// Newton's iteration doubles the number of correct bits each time
+	uint64_t result = value;
+	for(int i = 0; i < 6; i++)
+		result *= 2 - value * result;
+	return result;
+}
+
+static const uint64_t INVERSE_BASE = inverse(BASE);
+
+// blank cells contribute nothing to the hash, so the tape may grow freely
+static inline uint64_t code(char symbol) {
+	return static_cast<unsigned char>(symbol) ^ static_cast<unsigned char>(Tape::EMPTY_SYMBOL);
+}
+
+char CycleDetector::Snapshot::at(int64_t position) const {
+	if(position < this->first || position - this->first >= static_cast<int64_t>(this->cells.size()))
+		return Tape::EMPTY_SYMBOL;
+	return this->cells[position - this->first];
+}
+
+CycleDetector::CycleDetector(const Tape* tape, uint32_t state) {
+
+	// hash the input, the head is at position 0
+	uint64_t factor = 1;
+	for(uint32_t i = tape->currentPos; i < tape->length; i++) {
+		this->tapeHash += code(tape->data[i]) * factor;
+		factor *= BASE;
+	}
+	factor = INVERSE_BASE;
+	for(uint32_t i = tape->currentPos; i > 0; i--) {
+		this->tapeHash += code(tape->data[i - 1]) * factor;
+		factor *= INVERSE_BASE;
+	}
+
+	// the input counts as visited for the records
+	this->checkpoint = this->takeSnapshot(tape, state);
+	this->checkpointHash = this->configurationHash(state);
+	this->extreme[0] = std::max<int64_t>(0, this->checkpoint.first + this->checkpoint.cells.size() - 1);
+	this->extreme[1] = std::min<int64_t>(0, this->checkpoint.first);
+}
+
+bool CycleDetector::afterStep(const Tape* tape, uint32_t state, char read, const Transition& transition) {
+	this->steps++;
+
+	// update the hash for the written symbol, then follow the head
+	this->tapeHash += (code(transition.writeSymbol) - code(read)) * this->power;
+	if(transition.direction == Direction::LEFT) {
+		this->head--;
+		this->power *= INVERSE_BASE;
+		this->inversePower *= BASE;
+	} else if(transition.direction == Direction::RIGHT) {
+		this->head++;
+		this->power *= BASE;
+		this->inversePower *= INVERSE_BASE;
+	}
+
+	// Brent's algorithm: compare with a checkpoint taken at the last power of two
+	uint64_t hash = this->configurationHash(state);
+	if(hash == this->checkpointHash && this->sameConfiguration(this->checkpoint, tape, state))
+		return false;
+
+	if(this->steps == this->nextCheckpoint) {
+		this->checkpoint = this->takeSnapshot(tape, state);
+		this->checkpointHash = hash;
+		this->nextCheckpoint *= 2;
+	}
+
+	for(int side = 0; side < 2; side++) {
+		int64_t sign = side == 0 ? 1 : -1;
+
+		Record& record = this->records[side];
+		if(record.valid)
+			record.excursion = std::max(record.excursion, sign * (record.snapshot.head - this->head));
+
+		if(sign * this->head > sign * this->extreme[side]) {
+			this->extreme[side] = this->head;
+			if(!this->checkRecord(side, tape, state))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+char CycleDetector::cellAt(const Tape* tape, int64_t position) const {
+	int64_t index = position + tape->currentPos - this->head;
+	if(index < 0 || index >= tape->length)
+		return Tape::EMPTY_SYMBOL;
+	return tape->data[index];
+}
+
+CycleDetector::Snapshot CycleDetector::takeSnapshot(const Tape* tape, uint32_t state) const {
+	Snapshot snapshot;
+	snapshot.head = this->head;
+	snapshot.state = state;
+	snapshot.step = this->steps;
+
+	// store the content of the tape without the blanks around it
+	uint32_t begin = 0, end = tape->length;
+	while(begin < end && tape->data[begin] == Tape::EMPTY_SYMBOL)
+		begin++;
+	while(end > begin && tape->data[end - 1] == Tape::EMPTY_SYMBOL)
+		end--;
+
+	snapshot.cells.assign(tape->data + begin, end - begin);
+	snapshot.first = static_cast<int64_t>(begin) - tape->currentPos + this->head;
+	return snapshot;
+}
+
+uint64_t CycleDetector::configurationHash(uint32_t state) const {
+	// the hash of the tape relative to the head does not change with shifts
+	uint64_t hash = this->tapeHash * this->inversePower;
+	hash ^= (state + 1) * 0xBF58476D1CE4E5B9ull;
+
+	// mix the bits
+	hash ^= hash >> 31;
+	hash *= 0x94D049BB133111EBull;
+	hash ^= hash >> 29;
+	return hash;
+}
+
+bool CycleDetector::sameConfiguration(const Snapshot& snapshot, const Tape* tape, uint32_t state) const {
+	if(snapshot.state != state)
+		return false;
+
+	Snapshot current = this->takeSnapshot(tape, state);
+	if(current.cells != snapshot.cells)
+		return false;
+
+	// a blank tape looks the same from everywhere
+	return current.cells.empty() || current.head - current.first == snapshot.head - snapshot.first;
+}
+
+bool CycleDetector::checkRecord(int side, const Tape* tape, uint32_t state) {
+	int64_t sign = side == 0 ? 1 : -1;
+	Record& record = this->records[side];
+
+	// compare with the last record as far back as the head went since then
+	if(record.valid && record.snapshot.state == state
+		&& this->steps - record.lastCompare >= static_cast<uint64_t>(record.excursion)) {
+
+		record.lastCompare = this->steps;
+
+		bool same = true;
+		for(int64_t k = 0; k <= record.excursion && same; k++)
+			same = record.snapshot.at(record.snapshot.head - sign * k) == this->cellAt(tape, this->head - sign * k);
+
+		if(same)
+			return false;
+	}
+
+	// take a new record every now and then, in growing intervals
+	if(!record.valid || this->steps - record.snapshot.step >= record.interval) {
+		record.valid = true;
+		record.snapshot = this->takeSnapshot(tape, state);
+		record.excursion = 0;
+		record.lastCompare = this->steps;
+		record.interval *= 2;
+	}
+
+	return true;
+}
@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "include/Debugger.hpp"
+
+Debugger::Debugger(const CompiledMachine& machine, const RunOptions& options)
+	: machine(machine), options(options) {
+
+	// waiting for commands does not count, and the run is only shown when it stops
+	this->options.deadline = std::chrono::steady_clock::time_point::max();
+	this->options.showDebug = false;
+	this->options.traceFile.clear();
+	this->options.checkpointFile.clear();
+	this->options.profile = nullptr;
+	this->options.resume = nullptr;
+
+	// the whole tape of a long run is of no use at every stop
+	if(this->options.debugWindow == 0)
+		this->options.debugWindow = 40;
+}
+
+RunResult Debugger::run(Tape* tape) {
+	RunResult current;
+	current.state = this->machine.startState();
+	current.reason = HaltReason::STOPPED;
+	this->runTime = std::chrono::duration<double>(0);
+
+	std::cout << std::endl;
+	this->show(tape, current, this->options.debugWindow);
+
+	// an empty line repeats the last command
+	std::string line, last = "step";
+	while(true) {
+		std::cout << "(tm) " << std::flush;
+		if(!std::getline(std::cin, line)) {
+			std::cout << std::endl;
+			current.reason = HaltReason::STOPPED;
+			break;
+		}
+
+		bool blank = std::all_of(line.begin(), line.end(), [](char c) {
+			return std::isspace(static_cast<unsigned char>(c)) != 0;
+		});
+		if(blank)
+			line = last;
+		else
+			last = line;
+
+		if(!this->execute(line, tape, current))
+			break;
+	}
+
+	current.accepted = current.reason == HaltReason::HALTED && this->machine.isFinal(current.state);
+	current.peakTapeSize = tape->length;
+	current.elapsed = this->runTime;
+	return current;
+}
+
+bool Debugger::execute(const std::string& command, Tape* tape, RunResult& current) {
+	std::istringstream stream(command);
+	std::vector<std::string> words;
+	std::string word;
+	while(stream >> word)
+		words.push_back(word);
+	if(words.empty())
+		return true;
+	const std::string& name = words[0];
+
+	if(name == "c" || name == "continue" || name == "s" || name == "step") {
+		uint64_t count = 0;
+		if(name == "s" || name == "step")
+			count = words.size() > 1 ? std::max<uint64_t>(strtoull(words[1].c_str(), nullptr, 10), 1) : 1;
+
+		this->proceed(tape, current, count);
+		this->show(tape, current, this->options.debugWindow);
+		return current.reason == HaltReason::STOPPED;
+	}
+
+	if(name == "b" || name == "break")
+		this->addBreakpoint(words);
+	else if(name == "d" || name == "delete") {
+		size_t number = words.size() > 1 ? strtoull(words[1].c_str(), nullptr, 10) : 0;
+		if(words.size() == 1)
+			this->breakpoints.clear();
+		else if(number >= 1 && number <= this->breakpoints.size())
+			this->breakpoints.erase(this->breakpoints.begin() + number - 1);
+		else
+			std::cout << "There is no breakpoint " << words[1] << std::endl;
+		this->patch();
+	} else if(name == "i" || name == "info")
+		this->listBreakpoints();
+	else if(name == "t" || name == "tape")
+		this->show(tape, current, words.size() > 1 ? strtoull(words[1].c_str(), nullptr, 10) : this->options.debugWindow);
+	else if(name == "stats")
+		this->showStats(tape, current);
+	else if(name == "h" || name == "help")
+		this->showHelp();
+	else if(name == "q" || name == "quit") {
+		current.reason = HaltReason::STOPPED;
+		return false;
+	} else
+		std::cout << "Unknown command '" << name << "', see help" << std::endl;
+	return true;
+}
+
+void Debugger::proceed(Tape* tape, RunResult& current, uint64_t count) {
+	if(count != 0) {
+		this->runOriginal(tape, current, count, false);
+		return;
+	}
+
+	// the breakpoint the run stopped at would stop it again right away, so the original machine takes the step
+	char symbol = tape->getSymbol();
+	const Transition& next = this->machine.lookup(current.state, symbol);
+	if(next.kind != TransitionKind::HALT && !this->halts.empty()
+		&& this->stops.lookup(current.state, symbol).kind == TransitionKind::HALT) {
+		uint32_t origin = current.state;
+		if(!this->runOriginal(tape, current, 1, true))
+			return;
+		if(next.target != origin && this->stateBreakpoint(next.target) != 0) {
+			this->announce(this->stateBreakpoint(next.target));
+			return;
+		}
+	}
+
+	// run up to the next breakpoint on a step
+	RunOptions options = this->options;
+	options.proceed = &current;
+	options.watch = this->watch.empty() ? nullptr : &this->watch;
+	for(const Breakpoint& breakpoint : this->breakpoints) {
+		uint64_t step = breakpoint.value;
+		if(breakpoint.kind == STEP && step > current.steps && (options.maxSteps == 0 || step < options.maxSteps))
+			options.maxSteps = step;
+	}
+
+	const CompiledMachine& machine = this->halts.empty() ? this->machine : this->stops;
+	RunResult result = machine.run(tape, options);
+	this->runTime += result.elapsed;
+	current = result;
+
+	if(result.reason == HaltReason::STOPPED) {
+		this->announce(this->cellBreakpoint());
+		return;
+	}
+	if(result.reason == HaltReason::STEP_LIMIT) {
+		if(this->options.maxSteps != 0 && result.steps >= this->options.maxSteps)
+			return;
+		current.reason = HaltReason::STOPPED;
+		this->announce(this->stepBreakpoint(result.steps));
+		return;
+	}
+	if(result.reason != HaltReason::HALTED)
+		return;
+
+	// the machine halted, unless it was the copy that halted at a breakpoint
+	symbol = tape->getSymbol();
+	const Transition& transition = this->machine.lookup(current.state, symbol);
+	if(transition.kind == TransitionKind::HALT)
+		return;
+
+	current.reason = HaltReason::STOPPED;
+	size_t rule = this->ruleBreakpoint(current.state, symbol);
+	if(rule != 0) {
+		this->announce(rule);
+		return;
+	}
+
+	// a breakpoint on the state the transition enters stops the machine in that state
+	uint32_t target = transition.target;
+	if(this->runOriginal(tape, current, 1, true))
+		this->announce(this->stateBreakpoint(target));
+}
+
+bool Debugger::runOriginal(Tape* tape, RunResult& current, uint64_t steps, bool watching) {
+	RunOptions options = this->options;
+	options.proceed = &current;
+	options.maxSteps = current.steps + steps;
+	if(this->options.maxSteps != 0)
+		options.maxSteps = std::min(options.maxSteps, this->options.maxSteps);
+	options.watch = watching && !this->watch.empty() ? &this->watch : nullptr;
+
+	RunResult result = this->machine.run(tape, options);
+	this->runTime += result.elapsed;
+	current = result;
+
+	if(result.reason == HaltReason::STOPPED) {
+		this->announce(this->cellBreakpoint());
+		return false;
+	}
+	if(result.reason != HaltReason::STEP_LIMIT
+		|| (this->options.maxSteps != 0 && result.steps >= this->options.maxSteps))
+		return false;
+
+	current.reason = HaltReason::STOPPED;
+	return true;
+}
+
+size_t Debugger::ruleBreakpoint(uint32_t state, char symbol) const {
+	for(size_t i = 0; i < this->breakpoints.size(); i++) {
+		const Breakpoint& breakpoint = this->breakpoints[i];
+		if(breakpoint.kind == RULE && breakpoint.state == state && breakpoint.symbol == symbol)
+			return i + 1;
+	}
+	return 0;
+}
+
+size_t Debugger::stateBreakpoint(uint32_t state) const {
+	for(size_t i = 0; i < this->breakpoints.size(); i++) {
+		if(this->breakpoints[i].kind == STATE && this->breakpoints[i].state == state)
+			return i + 1;
+	}
+	return 0;
+}
+
+size_t Debugger::stepBreakpoint(uint64_t step) const {
+	for(size_t i = 0; i < this->breakpoints.size(); i++) {
+		if(this->breakpoints[i].kind == STEP && static_cast<uint64_t>(this->breakpoints[i].value) == step)
+			return i + 1;
+	}
+	return 0;
+}
+
+size_t Debugger::cellBreakpoint() const {
+	BreakpointKind kind = this->watch.written ? CELL : POSITION;
+	for(size_t i = 0; i < this->breakpoints.size(); i++) {
+		if(this->breakpoints[i].kind == kind && this->breakpoints[i].value == this->watch.hit)
+			return i + 1;
+	}
+	return 0;
+}
+
+void Debugger::patch() {
+	// the copy is only made once it is needed
+	if(this->stops.stateCount() != this->machine.stateCount())
+		this->stops.copy(this->machine);
+
+	// undo the transitions to HALT of the breakpoints before
+	for(const auto& halt : this->halts)
+		this->stops.setTransition(halt.first, halt.second, this->machine.lookup(halt.first, halt.second));
+	this->halts.clear();
+	this->watch.positions.clear();
+	this->watch.cells.clear();
+
+	for(const Breakpoint& breakpoint : this->breakpoints) {
+		if(breakpoint.kind == RULE)
+			this->halts.push_back({breakpoint.state, breakpoint.symbol});
+		else if(breakpoint.kind == POSITION)
+			this->watch.positions.push_back(breakpoint.value);
+		else if(breakpoint.kind == CELL)
+			this->watch.cells.push_back(breakpoint.value);
+		if(breakpoint.kind != STATE)
+			continue;
+
+		// every transition into the state from another one halts
+		for(uint32_t state = 0; state < this->machine.stateCount(); state++) {
+			if(state == breakpoint.state)
+				continue;
+			for(uint32_t symbol = 0; symbol < CompiledMachine::SYMBOLS; symbol++) {
+				const Transition& transition = this->machine.lookup(state, static_cast<char>(symbol));
+				if(transition.kind != TransitionKind::HALT && transition.target == breakpoint.state)
+					this->halts.push_back({state, static_cast<char>(symbol)});
+			}
+		}
+	}
+
+	for(const auto& halt : this->halts)
+		this->stops.clearTransition(halt.first, halt.second);
+}
+
+void Debugger::announce(size_t number) const {
+	if(number != 0)
+		std::cout << "Breakpoint " << number << ": " << this->describe(this->breakpoints[number - 1]) << std::endl;
+}
+
+bool Debugger::findState(const std::string& name, uint32_t& state) const {
+	for(state = 0; state < this->machine.stateCount(); state++) {
+		if(this->machine.stateName(state) == name)
+			return true;
+	}
+	std::cout << "There is no state '" << name << "'" << std::endl;
+	return false;
+}
+
+void Debugger::addBreakpoint(const std::vector<std::string>& words) {
+	Breakpoint breakpoint = {STATE, 0, '\0', 0};
+	bool valid = false;
+
+	if((words.size() == 3 || words.size() == 4) && words[1] == "state") {
+		if(!this->findState(words[2], breakpoint.state))
+			return;
+		if(words.size() == 4) {
+			breakpoint.kind = RULE;
+			breakpoint.symbol = words[3][0];
+		}
+		valid = words.size() == 3 || words[3].size() == 1;
+	} else if(words.size() == 3 && (words[1] == "step" || words[1] == "head" || words[1] == "cell")) {
+		breakpoint.kind = words[1] == "step" ? STEP : words[1] == "head" ? POSITION : CELL;
+		char* end;
+		breakpoint.value = strtoll(words[2].c_str(), &end, 10);
+		valid = *end == '\0' && (breakpoint.kind != STEP || breakpoint.value > 0);
+	}
+
+	if(!valid) {
+		std::cout << "Expected break state NAME [SYMBOL], break step N, break head CELL or break cell CELL" << std::endl;
+		return;
+	}
+
+	this->breakpoints.push_back(breakpoint);
+	this->patch();
+	std::cout << "Set breakpoint " << this->breakpoints.size() << ": " << this->describe(breakpoint) << std::endl;
+}
+
+void Debugger::listBreakpoints() const {
+	if(this->breakpoints.empty())
+		std::cout << "No breakpoints" << std::endl;
+	for(size_t i = 0; i < this->breakpoints.size(); i++)
+		std::cout << i + 1 << ": " << this->describe(this->breakpoints[i]) << std::endl;
+}
+
+std::string Debugger::describe(const Breakpoint& breakpoint) const {
+	switch(breakpoint.kind) {
+		case STATE:
+		return "entering state " + std::string(this->machine.stateName(breakpoint.state));
+		case RULE:
+		return "state " + std::string(this->machine.stateName(breakpoint.state)) + " reading " + breakpoint.symbol;
+		case STEP:
+		return "step " + std::to_string(breakpoint.value);
+		case POSITION:
+		return "head at cell " + std::to_string(breakpoint.value);
+		case CELL:
+		return "cell " + std::to_string(breakpoint.value) + " changes";
+	}
+	return "";
+}
+
+void Debugger::show(const Tape* tape, const RunResult& current, uint64_t radius) const {
+	std::string out = "Step " + std::to_string(current.steps) + ", state ";
+	out += this->machine.stateName(current.state);
+	out += ", head at cell " + std::to_string(static_cast<int64_t>(tape->currentPos) - tape->origin) + '\n';
+	tape->render(out, radius);
+	out += '\n';
+	std::cout.write(out.data(), out.size());
+}
+
+void Debugger::showStats(const Tape* tape, const RunResult& current) const {
+	std::cout << "steps: " << current.steps << ", state: " << this->machine.stateName(current.state)
+		<< ", head at cell " << static_cast<int64_t>(tape->currentPos) - tape->origin
+		<< ", tape size: " << tape->length << " cells" << std::endl;
+	std::cout << "time running: " << this->runTime.count() << " s";
+	if(this->runTime.count() > 0)
+		std::cout << ", " << static_cast<uint64_t>(current.steps / this->runTime.count()) << " steps per second";
+	std::cout << std::endl;
+}
+
+void Debugger::showHelp() const {
+	std::cout << "Commands, an empty line repeats the last one:" << std::endl;
+	std::cout << "  continue, c: Run up to the next breakpoint" << std::endl;
+	std::cout << "  step [N], s [N]: Run one or N steps, ignoring breakpoints" << std::endl;
+	std::cout << "  break state NAME, b state NAME: Stop when the machine enters the state from another one" << std::endl;
+	std::cout << "  break state NAME SYMBOL: Stop before the state reads the symbol" << std::endl;
+	std::cout << "  break step N: Stop after N steps" << std::endl;
+	std::cout << "  break head CELL: Stop when the head reaches the cell, counted from the first cell of the input" << std::endl;
+	std::cout << "  break cell CELL: Stop when the symbol in the cell changes" << std::endl;
+	std::cout << "  info, i: List the breakpoints" << std::endl;
+	std::cout << "  delete [N], d [N]: Remove breakpoint N, or all breakpoints" << std::endl;
+	std::cout << "  tape [CELLS], t [CELLS]: Show the tape with this many cells on each side of the head, 0 for all" << std::endl;
+	std::cout << "  stats: Show the steps, the tape size and how fast the machine runs" << std::endl;
+	std::cout << "  quit, q: Stop the run" << std::endl;
+	std::cout << "Breakpoints on cells look at every step, so the machine runs slower while there are any." << std::endl;
+}
@@ -0,0 +1,253 @@
+#include "include/MachineParser.hpp"
+
+static inline bool isNameCharacter(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// a symbol that can be shown in a message
+static std::string quoted(char c) {
+	if(c >= ' ' && c <= '~')
+		return std::string("'") + c + "'";
+	return "character " + std::to_string(static_cast<unsigned char>(c));
+}
+
+bool LineParser::parse(std::string_view line, ParsedLine* result) {
+	// files written on Windows end their lines with "\r\n"
+	if(!line.empty() && line.back() == '\r')
+		line.remove_suffix(1);
+
+	this->line = line;
+	this->position = 0;
+
+	result->kind = LineKind::NOTHING;
+	result->origins.clear();
+	result->symbols.clear();
+	result->writes = false;
+
+	if(line.empty() || line[0] == '#')
+		return true;
+
+	if(this->startsWith("final ")) {
+		this->position += 6;
+		result->kind = LineKind::FINAL;
+		result->origins.emplace_back();
+		return this->name(&result->origins.back()) && this->expect(";") && this->end();
+	}
+
+	if(this->startsWith("alphabet ")) {
+		this->position += 9;
+		result->kind = LineKind::ALPHABET;
+		if(!this->startsWith("{"))
+			return this->fail("expected '{' to start the alphabet");
+		return this->symbolClass(&result->symbols) && this->expect(";") && this->end();
+	}
+
+	if(this->startsWith("tapes ")) {
+		this->position += 6;
+		result->kind = LineKind::TAPES;
+		size_t begin = this->position;
+		result->tapes = 0;
+		while(!this->atEnd() && this->line[this->position] >= '0' && this->line[this->position] <= '9'
+					&& result->tapes < 100)
+			result->tapes = result->tapes * 10 + (this->line[this->position++] - '0');
+		if(this->position == begin || result->tapes == 0 || result->tapes > 16) {
+			this->position = begin;
+			return this->fail("expected a number of tapes from 1 to 16");
+		}
+		return this->expect(";") && this->end();
+	}
+
+	// all other lines start with states, separated by commas
+	while(true) {
+		result->origins.emplace_back();
+		if(!this->name(&result->origins.back()))
+			return false;
+		if(!this->startsWith(","))
+			break;
+		this->position++;
+	}
+
+	if(!this->expect(": "))
+		return false;
+
+	if(this->startsWith("import "))
+		return this->import(result);
+	return this->rule(result);
+}
+
+bool LineParser::rule(ParsedLine* result) {
+	result->kind = LineKind::RULE;
+
+	// the symbols to read, with several tapes a tuple like "a|{b,c}"
+	result->moreSymbols.resize(this->tapes - 1);
+	if(!this->readSymbols(&result->symbols))
+		return false;
+	for(std::vector<char>& symbols : result->moreSymbols) {
+		symbols.clear();
+		if(!this->expect("|") || !this->readSymbols(&symbols))
+			return false;
+	}
+	if(!this->expect(","))
+		return false;
+
+	// the symbols to write are optional, they are followed by another comma
+	size_t tuple = 2 * this->tapes - 1;
+	result->moreWrites.clear();
+	if(!this->startsWith("jump ") && this->position + tuple < this->line.size()
+		&& this->line[this->position + tuple] == ',') {
+		result->writes = true;
+		result->writeSymbol = this->line[this->position];
+		this->position++;
+		for(unsigned tape = 1; tape < this->tapes; tape++) {
+			result->moreWrites.push_back('\0');
+			if(!this->expect("|") || !this->symbol(&result->moreWrites.back()))
+				return false;
+		}
+		this->position++;
+	}
+
+	if(this->startsWith("jump ")) {
+		if(this->tapes > 1)
+			return this->fail("jumps are only possible on a single tape");
+		this->position += 5;
+		result->kind = LineKind::JUMP;
+		if(!this->direction(&result->direction, false) || !this->expect(" until ")
+			|| !this->symbol(&result->stopSymbol))
+			return false;
+	} else if(!this->direction(&result->direction, true)) {
+		return false;
+	}
+
+	result->moreDirections.resize(this->tapes - 1);
+	for(Direction& direction : result->moreDirections) {
+		if(!this->expect("|") || !this->direction(&direction, true))
+			return false;
+	}
+
+	return this->expect(" -> ") && this->name(&result->target) && this->end();
+}
+
+bool LineParser::import(ParsedLine* result) {
+	this->position += 7;
+	result->kind = LineKind::IMPORT;
+
+	if(result->origins.size() != 1) {
+		this->errorPosition = 0;
+		this->error = "a machine can only be imported as a single state";
+		return false;
+	}
+
+	if(!this->expect("\""))
+		return false;
+	size_t close = this->line.find('"', this->position);
+	if(close == std::string_view::npos || close == this->position)
+		return this->fail("expected a file name followed by '\"'");
+	result->file = this->line.substr(this->position, close - this->position);
+	this->position = close + 1;
+
+	result->importStart = std::string_view();
+	if(this->startsWith(" at ")) {
+		this->position += 4;
+		if(!this->name(&result->importStart))
+			return false;
+	}
+
+	return this->expect(" -> ") && this->name(&result->target) && this->end();
+}
+
+bool LineParser::fail(const std::string& message) {
+	this->errorPosition = this->position;
+	this->error = message;
+	return false;
+}
+
+bool LineParser::atEnd() const {
+	return this->position >= this->line.size();
+}
+
+bool LineParser::startsWith(std::string_view text) const {
+	return this->line.compare(this->position, text.size(), text) == 0;
+}
+
+bool LineParser::expect(std::string_view text) {
+	if(!this->startsWith(text))
+		return this->fail("expected '" + std::string(text) + "'");
+	this->position += text.size();
+	return true;
+}
+
+bool LineParser::name(std::string_view* result) {
+	size_t begin = this->position;
+	while(!this->atEnd() && isNameCharacter(this->line[this->position]))
+		this->position++;
+
+	if(this->position == begin)
+		return this->fail("expected a state name (letters, digits and '_')");
+
+	*result = this->line.substr(begin, this->position - begin);
+	return true;
+}
+
+bool LineParser::symbol(char* result) {
+	if(this->atEnd())
+		return this->fail("expected a symbol");
+	*result = this->line[this->position++];
+	return true;
+}
+
+bool LineParser::symbolClass(std::vector<char>* result) {
+	// '{' followed by symbols separated by commas and '}'
+	this->position++;
+	while(true) {
+		result->emplace_back();
+		if(!this->symbol(&result->back()))
+			return false;
+		if(!this->startsWith(","))
+			break;
+		this->position++;
+	}
+
+	if(!this->startsWith("}"))
+		return this->fail("expected ',' or '}' after a single symbol");
+	this->position++;
+	return true;
+}
+
+bool LineParser::readSymbols(std::vector<char>* result) {
+	if(this->startsWith("{"))
+		return this->symbolClass(result);
+
+	result->emplace_back();
+	return this->symbol(&result->back());
+}
+
+bool LineParser::direction(Direction* result, bool stand) {
+	if(this->atEnd())
+		return this->fail(stand ? "expected a direction (L, R or S)" : "expected a direction (L or R)");
+
+	switch(this->line[this->position]) {
+		case 'R': case 'r':
+		*result = Direction::RIGHT; break;
+		case 'L': case 'l':
+		*result = Direction::LEFT; break;
+		case 'S': case 's':
+		if(stand) {
+			*result = Direction::STAND;
+			break;
+		}
+		return this->fail("jumps can not stand still, expected L or R");
+		default:
+		return this->fail("unrecognized direction " + quoted(this->line[this->position])
+											+ (stand ? ", expected L, R or S" : ", expected L or R"));
+	}
+
+	this->position++;
+	return true;
+}
+
+bool LineParser::end() {
+	// comments may follow after a space
+	if(this->atEnd() || this->startsWith(" #"))
+		return true;
+	return this->fail("unexpected " + quoted(this->line[this->position]) + " after the end of the line");
+}
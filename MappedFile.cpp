@@ -0,0 +1,49 @@
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "include/MappedFile.hpp"
+
+MappedFile::~MappedFile() {
+	if(this->address != nullptr)
+		munmap(this->address, this->length);
+}
+
+bool MappedFile::open(const std::string& filename) {
+	if(this->address != nullptr)
+		munmap(this->address, this->length);
+	this->address = nullptr;
+	this->length = 0;
+
+	int descriptor = ::open(filename.c_str(), O_RDONLY);
+	if(descriptor < 0) {
+		std::cout << "Unable to open '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	struct stat status;
+	if(fstat(descriptor, &status) != 0) {
+		std::cout << "Unable to read '" << filename << "'" << std::endl;
+		close(descriptor);
+		return false;
+	}
+
+	// empty files can not be mapped, but they are valid nonetheless
+	if(status.st_size > 0) {
+		void* address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if(address == MAP_FAILED) {
+			std::cout << "Unable to map '" << filename << "' into memory" << std::endl;
+			close(descriptor);
+			return false;
+		}
+		this->address = address;
+		this->length = status.st_size;
+	}
+
+	// the mapping stays valid without the descriptor
+	close(descriptor);
+	return true;
+}
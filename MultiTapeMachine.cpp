@@ -0,0 +1,113 @@
+#include "include/DebugView.hpp"
+#include "include/MultiTapeMachine.hpp"
+#include "include/Tape.hpp"
+
+// number of steps between two checks of the run limits
+#define CHECK_INTERVAL	4096
+
+namespace {
+
+// the tapes of a run, shown one below the other
+struct TapeSet {
+	const std::vector<Tape*>& tapes;
+
+	void render(std::string& out, uint64_t radius) const {
+		for(size_t t = 0; t < this->tapes.size(); t++) {
+			if(t > 0)
+				out += '\n';
+			this->tapes[t]->render(out, radius);
+		}
+	}
+};
+
+uint64_t cells(const std::vector<Tape*>& tapes) {
+	uint64_t sum = 0;
+	for(const Tape* tape : tapes)
+		sum += tape->length;
+	return sum;
+}
+
+}
+
+inline size_t MultiTapeMachine::entry(uint32_t state, const std::vector<Tape*>& tapes) const {
+	size_t column = 0;
+	for(size_t t = this->tapes; t-- > 0;)
+		column = column * this->symbols + this->symbolIndex[static_cast<unsigned char>(tapes[t]->getSymbol())];
+	return state * this->columns + column;
+}
+
+RunResult MultiTapeMachine::run(const std::vector<Tape*>& tapes, const RunOptions& options) const {
+	auto startTime = std::chrono::steady_clock::now();
+	bool checkDeadline = options.deadline != std::chrono::steady_clock::time_point::max();
+
+	RunResult result;
+	uint32_t currentState = this->start;
+
+	TapeSet all{tapes};
+	DebugView<MultiTapeMachine> view(*this, options);
+	if(options.showDebug)
+		view.show(&all, currentState, 0);
+
+	while(true) {
+		// execute a block of steps without looking at the limits
+		uint64_t block = CHECK_INTERVAL;
+		if(options.maxSteps != 0) {
+			if(result.steps >= options.maxSteps) {
+				result.reason = HaltReason::STEP_LIMIT;
+				break;
+			}
+			if(options.maxSteps - result.steps < block)
+				block = options.maxSteps - result.steps;
+		}
+
+		uint64_t done = 0;
+		bool halted = false;
+		while(done < block) {
+			size_t entry = this->entry(currentState, tapes);
+			if(this->targets[entry] == HALT) {
+				halted = true;
+				break;
+			}
+
+			// apply the rule to every tape
+			const char* write = &this->writes[entry * this->tapes];
+			const uint8_t* direction = &this->directions[entry * this->tapes];
+			for(uint32_t t = 0; t < this->tapes; t++) {
+				tapes[t]->putSymbol(write[t]);
+				if(direction[t] == Direction::LEFT)
+					tapes[t]->stepLeft();
+				else if(direction[t] == Direction::RIGHT)
+					tapes[t]->stepRight();
+			}
+
+			currentState = this->targets[entry];
+			done++;
+
+			if(options.showDebug)
+				view.afterStep(&all, currentState, result.steps + done);
+		}
+		result.steps += done;
+
+		if(halted)
+			break;
+
+		if(options.maxTapeCells != 0 && cells(tapes) > options.maxTapeCells) {
+			result.reason = HaltReason::TAPE_LIMIT;
+			break;
+		}
+
+		if(checkDeadline && std::chrono::steady_clock::now() >= options.deadline) {
+			result.reason = HaltReason::TIMEOUT;
+			break;
+		}
+	}
+
+	if(options.showDebug)
+		view.finish(&all, currentState, result.steps);
+
+	result.accepted = result.reason == HaltReason::HALTED && this->isFinal(currentState);
+	result.peakTapeSize = cells(tapes);
+	result.elapsed = std::chrono::steady_clock::now() - startTime;
+
+	return result;
+}
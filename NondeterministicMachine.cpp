@@ -0,0 +1,205 @@
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "include/NondeterministicMachine.hpp"
+#include "include/SharedTape.hpp"
+#include "include/WorkStealingPool.hpp"
+
+// levels with fewer configurations are explored without starting threads
+#define PARALLEL_LEVEL	256
+
+// the configurations reached so far are spread over this many sets by
+// their fingerprint, so threads rarely wait for each other
+#define VISITED_SHARDS	64
+
+namespace {
+
+struct Configuration {
+	SharedTape tape;
+	uint32_t state;
+};
+
+struct FingerprintHash {
+	size_t operator()(const SharedTape::Fingerprint& fingerprint) const {
+		return fingerprint.first;
+	}
+};
+
+// configurations with the same fingerprint are told apart by their cells
+struct VisitedShard {
+	std::mutex lock;
+	std::unordered_multimap<SharedTape::Fingerprint, Configuration, FingerprintHash> configurations;
+};
+
+// rough estimates of the memory used by a chunk and by a reached configuration,
+// which is kept in a set and, while it waits to be explored, in the frontier;
+// both copies share their chunks but have pointers of their own to them
+const uint64_t CHUNK_BYTES = SharedTape::CHUNK_CELLS + 48;
+const uint64_t VISITED_BYTES = sizeof(SharedTape::Fingerprint) + sizeof(Configuration) + 2 * sizeof(void*);
+const uint64_t CONFIGURATION_BYTES = sizeof(Configuration) + VISITED_BYTES;
+
+}
+
+SearchResult NondeterministicMachine::search(const char* input, const SearchOptions& options) const {
+	auto startTime = std::chrono::steady_clock::now();
+	bool checkDeadline = options.deadline != std::chrono::steady_clock::time_point::max();
+
+	SearchResult result;
+	std::atomic<int64_t> chunks{0};
+
+	// the fingerprint of a configuration includes the state, which the tape does not know
+	std::vector<VisitedShard> visited(VISITED_SHARDS);
+	auto shardOf = [&](SharedTape::Fingerprint& fingerprint, uint32_t state) -> VisitedShard& {
+		fingerprint.first ^= (state + 1) * 0x9e3779b97f4a7c15ull;
+		fingerprint.second += state;
+		return visited[fingerprint.second % VISITED_SHARDS];
+	};
+
+	/*
+	 * Find out whether the step of a choice leads to a configuration that was
+	 * not reached before, and if so, add it to the successors and remember it.
+	 * Fingerprints only find the candidates, their cells are compared, so a
+	 * collision of fingerprints never drops a branch.
+	 */
+	auto firstVisit = [&](const Configuration& from, const Transition& choice, int move,
+												std::vector<Configuration>& successors) {
+		SharedTape::Fingerprint fingerprint = from.tape.fingerprintAfter(choice.writeSymbol, move);
+		VisitedShard& shard = shardOf(fingerprint, choice.target);
+		std::lock_guard<std::mutex> guard(shard.lock);
+
+		auto [candidate, end] = shard.configurations.equal_range(fingerprint);
+		for(; candidate != end; candidate++) {
+			if(candidate->second.state == choice.target
+				&& from.tape.sameAfter(candidate->second.tape, choice.writeSymbol, move))
+				return false;
+		}
+
+		// the successor shares all chunks the step does not write to
+		successors.push_back(from);
+		Configuration& next = successors.back();
+		next.tape.putSymbol(choice.writeSymbol);
+		if(move < 0)
+			next.tape.stepLeft();
+		else if(move > 0)
+			next.tape.stepRight();
+		next.state = choice.target;
+		shard.configurations.emplace(fingerprint, next);
+		return true;
+	};
+
+	std::vector<Configuration> frontier;
+	frontier.push_back({SharedTape(input, &chunks), this->start});
+	SharedTape::Fingerprint fingerprint = frontier[0].tape.fingerprint();
+	shardOf(fingerprint, this->start).configurations.emplace(fingerprint, frontier[0]);
+	result.configurations = 1;
+	result.peakTapeSize = frontier[0].tape.size();
+
+	// memory of the configurations that were reached, apart from their chunks
+	std::atomic<uint64_t> memory{CONFIGURATION_BYTES + 2 * frontier[0].tape.chunkCount() * sizeof(void*)};
+	std::atomic<uint64_t> reached{0}, duplicates{0}, peakTapeSize{result.peakTapeSize};
+
+	// why the search has to stop in the middle of a level
+	std::atomic<bool> accepted{false};
+	std::atomic<int> stopReason{HaltReason::HALTED};
+	std::mutex acceptLock;
+
+	WorkStealingPool pool(options.threads);
+
+	while(true) {
+		if(options.maxSteps != 0 && result.steps >= options.maxSteps) {
+			result.reason = HaltReason::STEP_LIMIT;
+			break;
+		}
+		if(checkDeadline && std::chrono::steady_clock::now() >= options.deadline) {
+			result.reason = HaltReason::TIMEOUT;
+			break;
+		}
+
+		// every configuration of the level gets a list of its new successors
+		std::vector<std::vector<Configuration>> successors(frontier.size());
+		reached = 0;
+
+		auto explore = [&](size_t i) {
+			if(accepted || stopReason != HaltReason::HALTED)
+				return;
+
+			const Configuration& configuration = frontier[i];
+			auto [choice, end] = this->lookup(configuration.state, configuration.tape.getSymbol());
+			if(choice == end) {
+				// the branch halted; the first accepting branch is reported
+				if(this->isFinal(configuration.state) && !accepted.exchange(true)) {
+					std::lock_guard<std::mutex> guard(acceptLock);
+					std::ostringstream tape;
+					tape << configuration.tape;
+					result.tape = tape.str();
+				}
+				return;
+			}
+
+			uint64_t dropped = 0;
+			for(; choice != end; choice++) {
+				int move = choice->direction == Direction::LEFT ? -1 : choice->direction == Direction::RIGHT ? 1 : 0;
+
+				// most successors were reached before, so they are only copied when they are new
+				if(!firstVisit(configuration, *choice, move, successors[i])) {
+					dropped++;
+					continue;
+				}
+
+				uint64_t size = successors[i].back().tape.size();
+				uint64_t peak = peakTapeSize;
+				while(size > peak && !peakTapeSize.compare_exchange_weak(peak, size));
+				uint64_t used = memory += CONFIGURATION_BYTES + 2 * successors[i].back().tape.chunkCount() * sizeof(void*);
+
+				if(options.maxTapeCells != 0 && size > options.maxTapeCells)
+					stopReason = HaltReason::TAPE_LIMIT;
+				if(options.maxFrontier != 0 && ++reached > options.maxFrontier)
+					stopReason = HaltReason::FRONTIER_LIMIT;
+				if(options.maxMemory != 0 && used + chunks * CHUNK_BYTES > options.maxMemory)
+					stopReason = HaltReason::MEMORY_LIMIT;
+			}
+			duplicates += dropped;
+		};
+
+		if(frontier.size() < PARALLEL_LEVEL || options.threads == 1) {
+			for(size_t i = 0; i < frontier.size(); i++)
+				explore(i);
+		} else {
+			pool.run(frontier.size(), explore);
+		}
+
+		if(accepted) {
+			result.accepted = true;
+			break;
+		}
+		if(stopReason != HaltReason::HALTED) {
+			result.reason = static_cast<HaltReason>(stopReason.load());
+			break;
+		}
+
+		// the explored configurations are only remembered in the sets
+		for(const Configuration& configuration : frontier)
+			memory -= sizeof(Configuration) + configuration.tape.chunkCount() * sizeof(void*);
+
+		// the next level, in the order of the configurations it came from
+		frontier.clear();
+		for(std::vector<Configuration>& list : successors) {
+			for(Configuration& configuration : list)
+				frontier.push_back(std::move(configuration));
+		}
+		successors.clear();
+		if(frontier.empty())
+			break;
+
+		result.steps++;
+		result.configurations += frontier.size();
+		result.peakFrontier = std::max<uint64_t>(result.peakFrontier, frontier.size());
+	}
+
+	result.duplicates = duplicates;
+	result.peakTapeSize = peakTapeSize;
+	result.elapsed = std::chrono::steady_clock::now() - startTime;
+	return result;
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cstring>
+
+#include "include/PackedTape.hpp"
+
+SymbolAlphabet::SymbolAlphabet(const std::string& symbols) {
+	memset(this->index, 0, sizeof(this->index));
+	memset(this->symbols, EMPTY_SYMBOL, sizeof(this->symbols));
+
+	// the empty symbol comes first, so new cells are zero
+	this->count = 1;
+	for(char symbol : symbols) {
+		if(this->contains(symbol))
+			continue;
+		if(this->count < MAX_SYMBOLS) {
+			this->symbols[this->count] = symbol;
+			this->index[static_cast<unsigned char>(symbol)] = this->count;
+		}
+		this->count++;
+	}
+}
+
+bool SymbolAlphabet::contains(char symbol) const {
+	return symbol == EMPTY_SYMBOL || this->index[static_cast<unsigned char>(symbol)] != 0;
+}
+
+unsigned SymbolAlphabet::bitsPerCell() const {
+	if(this->count <= 2)
+		return 1;
+	if(this->count <= 4)
+		return 2;
+	if(this->count <= MAX_SYMBOLS)
+		return 4;
+	return 0;
+}
+
+template<unsigned BITS>
+PackedTape<BITS>::PackedTape(const char* input, const SymbolAlphabet& alphabet, uint64_t startingPos)
+	: alphabet(alphabet) {
+
+	// leave a word of empty cells on each side of the input
+	uint64_t length = std::max<uint64_t>(strlen(input), startingPos + 1);
+	this->words.assign((length + CELLS_PER_WORD - 1) / CELLS_PER_WORD + 2, 0);
+	this->position = CELLS_PER_WORD;
+
+	for(const char* c = input; *c != '\0'; c++) {
+		this->putSymbol(*c);
+		this->position++;
+	}
+	this->position = CELLS_PER_WORD + startingPos;
+}
+
+template<unsigned BITS>
+std::ostream& PackedTape<BITS>::outputTape(std::ostream& stream) const {
+	std::string out;
+	this->render(out, 0);
+	return stream.write(out.data(), out.size());
+}
+
+template<unsigned BITS>
+void PackedTape<BITS>::render(std::string& out, uint64_t radius) const {
+	uint64_t first = 0, last = this->size();
+	if(radius != 0) {
+		first = this->position > radius ? this->position - radius : 0;
+		last = std::min<uint64_t>(this->size(), this->position + radius + 1);
+	}
+
+	// the cells and how many of them are hidden on each side
+	size_t lineStart = out.size();
+	if(first > 0)
+		out += "<" + std::to_string(first) + " ";
+	size_t indent = out.size() - lineStart;
+	for(uint64_t position = first; position < last; position++)
+		out += this->alphabet.symbols[this->cell(position)];
+	if(last < this->size())
+		out += " " + std::to_string(this->size() - last) + ">";
+	out += '\n';
+
+	// show the current position
+	out.append(indent + this->position - first, ' ');
+	out += '^';
+}
+
+template<unsigned BITS>
+uint64_t PackedTape<BITS>::findRight(uint64_t cells, unsigned symbol, bool equal) const {
+	if(cells == 0)
+		return 0;
+
+	// skip the cells before the head in its word
+	uint64_t word = this->position / CELLS_PER_WORD;
+	uint64_t found = matches(this->words[word], symbol, equal)
+		& (~uint64_t(0) << ((this->position % CELLS_PER_WORD) * BITS));
+
+	while(found == 0) {
+		uint64_t searched = (word + 1) * CELLS_PER_WORD - this->position;
+		if(searched >= cells)
+			return cells;
+		word++;
+		found = matches(this->words[word], symbol, equal);
+	}
+
+	uint64_t cell = word * CELLS_PER_WORD + __builtin_ctzll(found) / BITS;
+	return std::min(cell - this->position, cells);
+}
+
+template<unsigned BITS>
+uint64_t PackedTape<BITS>::findLeft(uint64_t cells, unsigned symbol, bool equal) const {
+	if(cells == 0)
+		return 0;
+
+	// skip the cells after the head in its word
+	uint64_t word = this->position / CELLS_PER_WORD;
+	unsigned used = (this->position % CELLS_PER_WORD + 1) * BITS;
+	uint64_t found = matches(this->words[word], symbol, equal)
+		& (used == 64 ? ~uint64_t(0) : (uint64_t(1) << used) - 1);
+
+	while(found == 0) {
+		uint64_t searched = this->position - word * CELLS_PER_WORD + 1;
+		if(searched >= cells)
+			return cells;
+		word--;
+		found = matches(this->words[word], symbol, equal);
+	}
+
+	uint64_t cell = word * CELLS_PER_WORD + (63 - __builtin_clzll(found)) / BITS;
+	return std::min(this->position - cell, cells);
+}
+
+template<unsigned BITS>
+void PackedTape<BITS>::growLeft() {
+	// grow by whole words, so the cells stay at their place within the words
+	size_t increment = this->words.size();
+	this->words.insert(this->words.begin(), increment, 0);
+
+	// the cells keep their contents, so the head moves along with them
+	this->position += increment * CELLS_PER_WORD;
+}
+
+template<unsigned BITS>
+void PackedTape<BITS>::growRight() {
+	this->words.resize(this->words.size() * 2, 0);
+}
+
+template class PackedTape<1>;
+template class PackedTape<2>;
+template class PackedTape<4>;
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string_view>
+
+#include "include/Profiler.hpp"
+
+Profiler::Profiler(const CompiledMachine& machine)
+	: machine(&machine), counts(static_cast<size_t>(machine.stateCount()) * CompiledMachine::SYMBOLS, 0) {
+}
+
+void Profiler::merge(const Profiler& other) {
+	for(size_t i = 0; i < this->counts.size() && i < other.counts.size(); i++)
+		this->counts[i] += other.counts[i];
+	this->steps += other.steps;
+
+	auto add = [](std::vector<uint64_t>& positions, const std::vector<uint64_t>& more) {
+		if(positions.size() < more.size())
+			positions.resize(more.size(), 0);
+		for(size_t i = 0; i < more.size(); i++)
+			positions[i] += more[i];
+	};
+	add(this->rightPositions, other.rightPositions);
+	add(this->leftPositions, other.leftPositions);
+	this->entries.clear();
+}
+
+uint64_t Profiler::stateSteps(uint32_t state) const {
+	uint64_t sum = 0;
+	if(state >= this->machine->stateCount())
+		return sum;
+	for(uint32_t symbol = 0; symbol < CompiledMachine::SYMBOLS; symbol++)
+		sum += this->counts[state * CompiledMachine::SYMBOLS + symbol];
+	return sum;
+}
+
+// the states TuringMachine::compile() adds to scan for the stop symbols of jumps
+static bool isScanState(const CompiledMachine& machine, uint32_t state) {
+	return machine.stateName(state).substr(0, 5) == "Loop_";
+}
+
+uint64_t Profiler::jumpSteps(uint32_t state) const {
+	const CompiledMachine& machine = *this->machine;
+	if(state >= machine.stateCount())
+		return 0;
+
+	// the jumps of the state by the scan state they lead into, as compiled
+	std::map<uint32_t, uint64_t> taken;
+	for(uint32_t symbol = 0; symbol < CompiledMachine::SYMBOLS; symbol++) {
+		const Transition& jump = machine.lookup(state, static_cast<char>(symbol));
+		if(jump.kind != TransitionKind::HALT && jump.target != state && isScanState(machine, jump.target))
+			taken[jump.target] += this->ruleCount(state, static_cast<char>(symbol));
+	}
+	if(taken.empty())
+		return 0;
+
+	if(this->entries.empty()) {
+		this->entries.assign(machine.stateCount(), 0);
+		const Transition* table = &machine.lookup(0, 0);
+		for(size_t i = 0; i < this->counts.size(); i++) {
+			if(table[i].kind != TransitionKind::HALT && table[i].target != i / CompiledMachine::SYMBOLS)
+				this->entries[table[i].target] += this->counts[i];
+		}
+	}
+
+	// a scan state only entered from this state belongs to it entirely
+	uint64_t steps = 0;
+	for(const auto& [scan, count] : taken) {
+		if(count == this->entries[scan])
+			steps += this->stateSteps(scan);
+		else if(count != 0)
+			steps += static_cast<uint64_t>(static_cast<double>(this->stateSteps(scan)) * count / this->entries[scan]);
+	}
+	return steps;
+}
+
+uint32_t Profiler::stateId(const std::string& name) const {
+	if(this->ids.empty()) {
+		for(uint32_t state = 0; state < this->machine->stateCount(); state++)
+			this->ids.emplace(std::string(this->machine->stateName(state)), state);
+	}
+
+	auto found = this->ids.find(name);
+	return found == this->ids.end() ? this->machine->stateCount() : found->second;
+}
+
+// a symbol that can be shown in the report
+static std::string printable(char symbol) {
+	if(symbol >= ' ' && symbol <= '~')
+		return std::string(1, symbol);
+	return "\\\\" + std::to_string(static_cast<unsigned char>(symbol));
+}
+
+static std::string percentage(uint64_t part, uint64_t whole) {
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(1) << (whole == 0 ? 0.0 : 100.0 * part / whole) << "%";
+	return out.str();
+}
+
+void Profiler::report(std::ostream& out, size_t top) const {
+	const CompiledMachine& machine = *this->machine;
+	out << "Profile of " << this->steps << " steps" << std::endl;
+
+	// the busiest states
+	std::vector<std::pair<uint64_t, uint32_t>> states;
+	for(uint32_t state = 0; state < machine.stateCount(); state++) {
+		uint64_t steps = this->stateSteps(state);
+		if(steps != 0)
+			states.push_back({steps, state});
+	}
+	std::sort(states.rbegin(), states.rend());
+
+	out << "States:" << std::endl;
+	for(size_t i = 0; i < states.size() && i < top; i++) {
+		out << std::setw(14) << states[i].first << std::setw(8) << percentage(states[i].first, this->steps)
+				<< "  " << machine.stateName(states[i].second) << std::endl;
+	}
+	if(states.size() > top)
+		out << "  and " << states.size() - top << " more states" << std::endl;
+
+	// the busiest rules
+	std::vector<std::pair<uint64_t, size_t>> rules;
+	for(size_t i = 0; i < this->counts.size(); i++) {
+		if(this->counts[i] != 0)
+			rules.push_back({this->counts[i], i});
+	}
+	std::sort(rules.rbegin(), rules.rend());
+
+	out << "Rules:" << std::endl;
+	for(size_t i = 0; i < rules.size() && i < top; i++) {
+		uint32_t state = rules[i].second / CompiledMachine::SYMBOLS;
+		char symbol = static_cast<char>(rules[i].second % CompiledMachine::SYMBOLS);
+		const Transition& transition = machine.lookup(state, symbol);
+		const char* direction = transition.direction == Direction::LEFT ? "L"
+			: transition.direction == Direction::RIGHT ? "R" : "S";
+
+		out << std::setw(14) << rules[i].first << std::setw(8) << percentage(rules[i].first, this->steps)
+				<< "  " << machine.stateName(state) << ": " << printable(symbol) << ","
+				<< printable(transition.writeSymbol) << "," << direction << " -> "
+				<< machine.stateName(transition.target) << std::endl;
+	}
+	if(rules.size() > top)
+		out << "  and " << rules.size() - top << " more rules" << std::endl;
+
+	// imported machines are recognized by the prefixes of their states; the
+	// state a machine is imported as and the scans of its jumps belong to it too
+	std::map<std::string_view, uint64_t> machines;
+	for(uint32_t state = 0; state < machine.stateCount(); state++) {
+		std::string_view name = machine.stateName(state);
+		if(isScanState(machine, state))
+			continue;
+		for(size_t end = name.find("__"); end != std::string_view::npos; end = name.find("__", end + 2))
+			machines[name.substr(0, end)];
+	}
+	for(uint32_t state = 0; state < machine.stateCount(); state++) {
+		if(isScanState(machine, state))
+			continue;
+		uint64_t steps = this->stateSteps(state) + this->jumpSteps(state);
+		if(steps == 0)
+			continue;
+
+		std::string_view name = machine.stateName(state);
+		auto own = machines.find(name);
+		if(own != machines.end())
+			own->second += steps;
+		for(size_t end = name.find("__"); end != std::string_view::npos; end = name.find("__", end + 2))
+			machines[name.substr(0, end)] += steps;
+	}
+
+	if(!machines.empty()) {
+		out << "Imported machines:" << std::endl;
+		for(const auto& [prefix, steps] : machines) {
+			out << std::setw(14) << steps << std::setw(8) << percentage(steps, this->steps)
+					<< "  " << prefix << std::endl;
+		}
+	}
+
+	// the head positions in up to 20 buckets of equal width
+	int64_t leftmost = -static_cast<int64_t>(this->leftPositions.size());
+	while(leftmost < 0 && this->leftPositions[-leftmost - 1] == 0)
+		leftmost++;
+	int64_t rightmost = static_cast<int64_t>(this->rightPositions.size()) - 1;
+	while(rightmost > 0 && this->rightPositions[rightmost] == 0)
+		rightmost--;
+	if(this->steps == 0)
+		return;
+
+	auto at = [&](int64_t position) {
+		if(position >= 0)
+			return position < static_cast<int64_t>(this->rightPositions.size()) ? this->rightPositions[position] : 0;
+		return this->leftPositions[-position - 1];
+	};
+
+	const int64_t BUCKETS = 20;
+	int64_t width = (rightmost - leftmost) / BUCKETS + 1;
+	std::vector<uint64_t> buckets;
+	for(int64_t position = leftmost; position <= rightmost; position++) {
+		if((position - leftmost) % width == 0)
+			buckets.push_back(0);
+		buckets.back() += at(position);
+	}
+	uint64_t most = *std::max_element(buckets.begin(), buckets.end());
+
+	out << "Head positions, relative to the start:" << std::endl;
+	for(size_t i = 0; i < buckets.size(); i++) {
+		int64_t from = leftmost + static_cast<int64_t>(i) * width;
+		int64_t to = std::min(from + width - 1, rightmost);
+		size_t bar = most == 0 ? 0 : (buckets[i] * 40 + most - 1) / most;
+		out << std::setw(9) << from << " .. " << std::setw(9) << to << std::setw(14) << buckets[i]
+				<< "  " << std::string(bar, '#') << std::endl;
+	}
+}
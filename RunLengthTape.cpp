@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
+
+#include "include/RunLengthTape.hpp"
+
+RunLengthTape::RunLengthTape(const char* input, uint64_t startingPos) : cells(0) {
+
+	// compress the input into runs
+	for(const char* c = input; *c != '\0'; c++) {
+		if(!this->runs.empty() && this->runs.back().symbol == *c)
+			this->runs.back().length++;
+		else
+			this->runs.push_back({*c, 1});
+		this->cells++;
+	}
+
+	// the head needs a cell to stand on
+	if(startingPos >= this->cells) {
+		if(!this->runs.empty() && this->runs.back().symbol == EMPTY_SYMBOL)
+			this->runs.back().length += startingPos - this->cells + 1;
+		else
+			this->runs.push_back({EMPTY_SYMBOL, startingPos - this->cells + 1});
+		this->cells = startingPos + 1;
+	}
+
+	// find the run of the starting position
+	this->current = this->runs.begin();
+	this->offset = startingPos;
+	while(this->offset >= this->current->length) {
+		this->offset -= this->current->length;
+		this->current++;
+	}
+}
+
+RunLengthTape::RunLengthTape(const RunLengthTape& other)
+	: runs(other.runs), offset(other.offset), cells(other.cells) {
+
+	// point to the same run in the copied list
+	this->current = this->runs.begin();
+	std::advance(this->current, std::distance(other.runs.begin(),
+		std::list<SymbolRun>::const_iterator(other.current)));
+}
+
+std::ostream& RunLengthTape::outputTape(std::ostream& stream) const {
+	std::string out;
+	this->render(out, 0);
+	return stream.write(out.data(), out.size());
+}
+
+void RunLengthTape::render(std::string& out, uint64_t radius) const {
+	if(radius == 0)
+		radius = this->cells;
+
+	// expand the runs to the left of the head, from the head outwards
+	std::string left;
+	uint64_t leftCells = this->offset;
+	left.append(std::min(this->offset, radius), this->current->symbol);
+	for(auto it = std::list<SymbolRun>::const_iterator(this->current); it != this->runs.begin();) {
+		it--;
+		leftCells += it->length;
+		if(left.size() < radius)
+			left.append(std::min(it->length, radius - left.size()), it->symbol);
+	}
+	std::reverse(left.begin(), left.end());
+
+	// and to the right, starting with the cell under the head
+	std::string right;
+	uint64_t rightCells = this->current->length - this->offset;
+	right.append(std::min(rightCells, radius + 1), this->current->symbol);
+	for(auto it = std::next(std::list<SymbolRun>::const_iterator(this->current)); it != this->runs.end(); it++) {
+		rightCells += it->length;
+		if(right.size() < radius + 1)
+			right.append(std::min(it->length, radius + 1 - right.size()), it->symbol);
+	}
+
+	size_t lineStart = out.size();
+	if(leftCells > left.size())
+		out += "<" + std::to_string(leftCells - left.size()) + " ";
+	size_t indent = out.size() - lineStart + left.size();
+	out += left;
+	out += right;
+	if(rightCells > right.size())
+		out += " " + std::to_string(rightCells - right.size()) + ">";
+	out += '\n';
+
+	// show the current position
+	out.append(indent, ' ');
+	out += '^';
+}
+
+void RunLengthTape::stepLeft() {
+	if(this->offset > 0) {
+		this->offset--;
+		return;
+	}
+
+	if(this->current == this->runs.begin()) {
+		// extend the tape to the left, growing a blank run if there is one
+		this->cells++;
+		if(this->current->symbol == EMPTY_SYMBOL) {
+			this->current->length++;
+			return;
+		}
+		this->runs.push_front({EMPTY_SYMBOL, 1});
+	}
+
+	this->current--;
+	this->offset = this->current->length - 1;
+}
+
+void RunLengthTape::stepRight() {
+	if(this->offset + 1 < this->current->length) {
+		this->offset++;
+		return;
+	}
+
+	if(std::next(this->current) == this->runs.end()) {
+		// extend the tape to the right, growing a blank run if there is one
+		this->cells++;
+		if(this->current->symbol == EMPTY_SYMBOL) {
+			this->current->length++;
+			this->offset++;
+			return;
+		}
+		this->runs.push_back({EMPTY_SYMBOL, 1});
+	}
+
+	this->current++;
+	this->offset = 0;
+}
+
+void RunLengthTape::skipLeft(uint64_t count) {
+	if(count <= this->offset) {
+		this->offset -= count;
+		return;
+	}
+
+	// leave the run at its left end
+	this->offset = 0;
+	this->stepLeft();
+}
+
+void RunLengthTape::skipRight(uint64_t count) {
+	if(this->offset + count < this->current->length) {
+		this->offset += count;
+		return;
+	}
+
+	// leave the run at its right end
+	this->offset = this->current->length - 1;
+	this->stepRight();
+}
+
+void RunLengthTape::putSymbol(char symbol) {
+	if(this->current->symbol == symbol)
+		return;
+
+	if(this->current->length == 1) {
+		this->current->symbol = symbol;
+		this->mergeCurrent();
+		return;
+	}
+
+	// cut the cell under the head out of its run
+	uint64_t before = this->offset;
+	uint64_t after = this->current->length - this->offset - 1;
+	char old = this->current->symbol;
+
+	if(before > 0)
+		this->runs.insert(this->current, {old, before});
+	if(after > 0)
+		this->runs.insert(std::next(this->current), {old, after});
+
+	this->current->symbol = symbol;
+	this->current->length = 1;
+	this->offset = 0;
+	this->mergeCurrent();
+}
+
+void RunLengthTape::mergeCurrent() {
+	if(this->current != this->runs.begin()) {
+		auto previous = std::prev(this->current);
+		if(previous->symbol == this->current->symbol) {
+			this->offset += previous->length;
+			this->current->length += previous->length;
+			this->runs.erase(previous);
+		}
+	}
+
+	auto next = std::next(this->current);
+	if(next != this->runs.end() && next->symbol == this->current->symbol) {
+		this->current->length += next->length;
+		this->runs.erase(next);
+	}
+}
+
+std::ostream& operator<<(std::ostream& stream, const RunLengthTape& tape) {
+	return tape.outputTape(stream);
+}
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "include/SharedTape.hpp"
+
+// odd bases of the hashes, and their inverses modulo 2^64 for moving left
+static const uint64_t BASES[2] = {0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full};
+
+static constexpr uint64_t inverse(uint64_t base) {
+	// Newton's iteration doubles the number of correct bits each time
+	uint64_t result = base;
+	for(int i = 0; i < 6; i++)
+		result *= 2 - base * result;
+	return result;
+}
+
+static const uint64_t INVERSES[2] = {inverse(BASES[0]), inverse(BASES[1])};
+
+// blank cells count as 0, so blank cells at the ends do not change the hashes
+static inline uint64_t value(char symbol) {
+	return static_cast<unsigned char>(symbol) ^ static_cast<unsigned char>(SharedTape::EMPTY_SYMBOL);
+}
+
+static inline uint64_t mix(uint64_t x) {
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+const std::shared_ptr<SharedTape::Chunk>& SharedTape::blankChunk() {
+	static const std::shared_ptr<Chunk> blank = [] {
+		auto chunk = std::make_shared<Chunk>();
+		memset(chunk->cells, EMPTY_SYMBOL, CHUNK_CELLS);
+		return chunk;
+	}();
+	return blank;
+}
+
+SharedTape::SharedTape(const char* input, std::atomic<int64_t>* allocated) : allocated(allocated) {
+	size_t length = std::strlen(input);
+
+	// the head needs a cell to stand on
+	size_t count = std::max<size_t>(1, (length + CHUNK_CELLS - 1) / CHUNK_CELLS);
+	for(size_t c = 0; c < count; c++) {
+		Chunk content;
+		memset(content.cells, EMPTY_SYMBOL, CHUNK_CELLS);
+		if(c * CHUNK_CELLS < length)
+			memcpy(content.cells, input + c * CHUNK_CELLS, std::min<size_t>(CHUNK_CELLS, length - c * CHUNK_CELLS));
+		this->chunks.push_back(this->newChunk(content));
+	}
+
+	for(size_t i = length; i-- > 0;) {
+		for(int k = 0; k < 2; k++)
+			this->hashes[k] = this->hashes[k] * BASES[k] + value(input[i]);
+	}
+}
+
+std::shared_ptr<SharedTape::Chunk> SharedTape::newChunk(const Chunk& content) const {
+	std::atomic<int64_t>* allocated = this->allocated;
+	if(allocated != nullptr)
+		(*allocated)++;
+
+	return std::shared_ptr<Chunk>(new Chunk(content), [allocated](Chunk* chunk) {
+		if(allocated != nullptr)
+			(*allocated)--;
+		delete chunk;
+	});
+}
+
+void SharedTape::putSymbol(char symbol) {
+	int64_t cell = this->head - this->first;
+	std::shared_ptr<Chunk>& chunk = this->chunks[cell / CHUNK_CELLS];
+	char old = chunk->cells[cell % CHUNK_CELLS];
+	if(old == symbol)
+		return;
+
+	// only a tape that holds the last pointer to a chunk may write to it
+	if(chunk.use_count() != 1)
+		chunk = this->newChunk(*chunk);
+	chunk->cells[cell % CHUNK_CELLS] = symbol;
+
+	for(int k = 0; k < 2; k++)
+		this->hashes[k] += (value(symbol) - value(old)) * this->powers[k];
+}
+
+void SharedTape::stepLeft() {
+	if(this->head == this->first) {
+		this->chunks.insert(this->chunks.begin(), blankChunk());
+		this->first -= CHUNK_CELLS;
+	}
+	this->head--;
+
+	for(int k = 0; k < 2; k++)
+		this->powers[k] *= INVERSES[k];
+}
+
+void SharedTape::stepRight() {
+	this->head++;
+	if(this->head - this->first == static_cast<int64_t>(this->size()))
+		this->chunks.push_back(blankChunk());
+
+	for(int k = 0; k < 2; k++)
+		this->powers[k] *= BASES[k];
+}
+
+// combine the hashes of the content with the head position
+static inline SharedTape::Fingerprint combine(const uint64_t (&hashes)[2], int64_t head) {
+	uint64_t position = mix(static_cast<uint64_t>(head));
+	return {mix(hashes[0] ^ position), mix(hashes[1] + position)};
+}
+
+SharedTape::Fingerprint SharedTape::fingerprint() const {
+	return combine(this->hashes, this->head);
+}
+
+SharedTape::Fingerprint SharedTape::fingerprintAfter(char symbol, int move) const {
+	uint64_t hashes[2];
+	uint64_t change = value(symbol) - value(this->getSymbol());
+	for(int k = 0; k < 2; k++)
+		hashes[k] = this->hashes[k] + change * this->powers[k];
+	return combine(hashes, this->head + move);
+}
+
+const SharedTape::Chunk* SharedTape::chunkAt(int64_t position) const {
+	if(position < this->first || position >= this->first + static_cast<int64_t>(this->size()))
+		return blankChunk().get();
+	return this->chunks[(position - this->first) / CHUNK_CELLS].get();
+}
+
+bool SharedTape::sameAfter(const SharedTape& other, char symbol, int move) const {
+	if(other.head != this->head + move)
+		return false;
+
+	// tapes only grow by whole chunks, so chunks start at the same positions on all tapes of an input
+	int64_t begin = std::min(this->first, other.first);
+	int64_t end = std::max(this->first + static_cast<int64_t>(this->size()),
+		other.first + static_cast<int64_t>(other.size()));
+	for(int64_t position = begin; position < end; position += CHUNK_CELLS) {
+		const Chunk* mine = this->chunkAt(position);
+		const Chunk* theirs = other.chunkAt(position);
+		bool written = this->head >= position && this->head < position + CHUNK_CELLS;
+		if(!written) {
+			if(mine != theirs && memcmp(mine->cells, theirs->cells, CHUNK_CELLS) != 0)
+				return false;
+			continue;
+		}
+
+		for(int64_t cell = 0; cell < CHUNK_CELLS; cell++) {
+			char content = position + cell == this->head ? symbol : mine->cells[cell];
+			if(content != theirs->cells[cell])
+				return false;
+		}
+	}
+	return true;
+}
+
+std::ostream& SharedTape::outputTape(std::ostream& stream) const {
+	std::string out;
+	for(const auto& chunk : this->chunks)
+		out.append(chunk->cells, CHUNK_CELLS);
+
+	// leave out the blank cells at the ends, but not the one under the head
+	size_t headCell = this->head - this->first;
+	size_t begin = std::min(out.find_first_not_of(EMPTY_SYMBOL), headCell);
+	size_t last = out.find_last_not_of(EMPTY_SYMBOL);
+	size_t end = std::max(last == std::string::npos ? 0 : last + 1, headCell + 1);
+
+	out = out.substr(begin, end - begin) + "\n" + std::string(headCell - begin, ' ') + "^";
+	return stream << out;
+}
+
+std::ostream& operator<<(std::ostream& stream, const SharedTape& tape) {
+	return tape.outputTape(stream);
+}
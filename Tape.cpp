@@ -1,8 +1,16 @@
+#include <algorithm>
+#include <cstdint>
 #include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "include/Tape.hpp"
 
-// extend the tape by this many symbols, if space is tight
+// space around the input, and the least the tape grows by if space is tight
 #define TAPE_INCREMENT	5
 
 Tape::Tape(const char* input, uint32_t startingPos)
@@ -22,6 +30,7 @@ Tape::Tape(const char* input, uint32_t startingPos)
 	// convert the const char* to a char[] by copying it
 	memcpy(this->data + TAPE_INCREMENT, input, len);
 	this->currentPos += TAPE_INCREMENT;
+	this->origin = TAPE_INCREMENT;
 }
 	
 Tape::Tape(char* input, uint32_t length, uint32_t startingPos)
@@ -39,10 +48,11 @@ Tape::Tape(char* input, uint32_t length, uint32_t startingPos)
 	// copy the data
 	memcpy(this->data + TAPE_INCREMENT, input, length);
 	this->currentPos += TAPE_INCREMENT;
+	this->origin = TAPE_INCREMENT;
 }
 
 Tape::Tape(const Tape& other) : length(other.length),
-	currentPos(other.currentPos) {
+	currentPos(other.currentPos), origin(other.origin) {
 	
 	// create a new data
 	this->data = new char[this->length];
@@ -53,76 +63,281 @@ Tape::Tape(const Tape& other) : length(other.length),
 }
 
 Tape::~Tape() {
-	delete this->data;
+	this->release();
 }
-	
-std::ostream& Tape::outputTape(std::ostream& stream) const {
-	// output the tape data
-	for(uint32_t i = 0; i < this->length; i++) {
-		stream << this->data[i];
+
+void Tape::release() {
+	if(this->mapping != 0)
+		munmap(this->data - this->mappingOffset, this->mapping);
+	else
+		delete[] this->data;
+	this->mapping = 0;
+	this->mappingOffset = 0;
+}
+
+// returns by how many cells a tape of the given length should grow
+static uint32_t growth(uint32_t length) {
+	uint32_t increment = length < TAPE_INCREMENT ? TAPE_INCREMENT : length;
+
+	// stay within the range of the position type
+	if(increment > UINT32_MAX - length)
+		increment = UINT32_MAX - length;
+	return increment;
+}
+
+void Tape::growLeft() {
+	uint32_t increment = growth(this->length);
+
+	// extend the data to the left
+	char* newData = new char[this->length + increment];
+	memset(newData, this->EMPTY_SYMBOL, increment);
+	memcpy(newData + increment, this->data, this->length);
+
+	// swap the data
+	this->release();
+	this->data = newData;
+	this->length += increment;
+
+	// the cells keep their contents, so the head moves along with them
+	this->currentPos += increment;
+	this->origin += increment;
+}
+
+void Tape::growRight() {
+	uint32_t increment = growth(this->length);
+
+	// extend the data to the right
+	char* newData = new char[this->length + increment];
+	memcpy(newData, this->data, this->length);
+	memset(newData + this->length, this->EMPTY_SYMBOL, increment);
+
+	// swap the data
+	this->release();
+	this->data = newData;
+	this->length += increment;
+}
+
+// find the last occurrence of a symbol in a range of memory
+static inline const char* findLast(const char* begin, char symbol, size_t length) {
+#ifdef __GLIBC__
+	return static_cast<const char*>(memrchr(begin, symbol, length));
+#else
+	for(const char* c = begin + length; c != begin; c--) {
+		if(c[-1] == symbol)
+			return c - 1;
 	}
-	stream << '\n';
-	
-	// show the current position
-	for(uint32_t i = 0; i < this->length; i++) {
-		if(i == this->currentPos)
-			stream << '^';
-		else 
-			stream << ' ';
+	return nullptr;
+#endif
+}
+
+// find the first cell in a range of memory that does not hold a symbol
+static inline const char* findOther(const char* begin, char symbol, size_t length) {
+	for(const char* c = begin; c != begin + length; c++) {
+		if(*c != symbol)
+			return c;
 	}
-	return stream;
+	return nullptr;
 }
 
-void Tape::stepLeft() {
-	
-	// move to left if possible
-	if(this->currentPos >= 1) {
-		this->currentPos--;
-	} else {
-		
-		// extend the data to the left
-		char* newData = new char[this->length + TAPE_INCREMENT];
-		memset(newData, this->EMPTY_SYMBOL, this->length + TAPE_INCREMENT);
-		memcpy(newData + TAPE_INCREMENT, this->data, this->length);
-		
-		// swao the data
-		delete this->data;
-		this->data = newData;
-		this->length = this->length + TAPE_INCREMENT;
-		
-		// move the new cursor to one less then the previous first
-		this->currentPos += TAPE_INCREMENT - 1;
+static inline const char* findLastOther(const char* begin, char symbol, size_t length) {
+	for(const char* c = begin + length; c != begin; c--) {
+		if(c[-1] != symbol)
+			return c - 1;
 	}
+	return nullptr;
 }
 
-void Tape::stepRight() {
-	
-	// move to right if possible
-	if(this->currentPos < this->length - 1) {
-		this->currentPos++;
-	} else {
-		
-		// extend the data to the right
-		char* newData = new char[this->length + TAPE_INCREMENT];
-		memset(newData, this->EMPTY_SYMBOL, this->length + TAPE_INCREMENT);
-		memcpy(newData, this->data, this->length);
-		
-		// swap the data
-		delete this->data;
-		this->data = newData;
-		this->length += TAPE_INCREMENT;
-		
-		// move the cursor to the next position
-		this->currentPos++;
+// move the head left by cells, where the cells up to the new position are in the buffer
+// except maybe for the last one
+static inline uint64_t moveLeft(Tape* tape, uint64_t cells) {
+	if(cells == 0)
+		return 0;
+	tape->currentPos -= cells - 1;
+	tape->stepLeft();
+	return cells;
+}
+
+static inline uint64_t moveRight(Tape* tape, uint64_t cells) {
+	if(cells == 0)
+		return 0;
+	tape->currentPos += cells - 1;
+	tape->stepRight();
+	return cells;
+}
+
+uint64_t Tape::scanLeft(char stop, uint64_t limit) {
+	// search from the head to the left end of the buffer
+	uint64_t available = std::min<uint64_t>(this->currentPos + 1, limit);
+	if(available == 0)
+		return 0;
+
+	const char* begin = this->data + this->currentPos + 1 - available;
+	const char* end = findLast(begin, stop, available);
+	if(end == nullptr)
+		return moveLeft(this, available);
+	return moveLeft(this, this->data + this->currentPos - end);
+}
+
+uint64_t Tape::scanRight(char stop, uint64_t limit) {
+	// search from the head to the right end of the buffer
+	uint64_t available = std::min<uint64_t>(this->length - this->currentPos, limit);
+	if(available == 0)
+		return 0;
+
+	const char* begin = this->data + this->currentPos;
+	const char* end = static_cast<const char*>(memchr(begin, stop, available));
+	if(end == nullptr)
+		return moveRight(this, available);
+	return moveRight(this, end - begin);
+}
+
+uint64_t Tape::sweepLeft(uint64_t limit) {
+	uint64_t available = std::min<uint64_t>(this->currentPos + 1, limit);
+	if(available == 0)
+		return 0;
+
+	const char* begin = this->data + this->currentPos + 1 - available;
+	const char* end = findLastOther(begin, this->getSymbol(), available);
+	if(end == nullptr)
+		return moveLeft(this, available);
+	return moveLeft(this, this->data + this->currentPos - end);
+}
+
+uint64_t Tape::sweepRight(uint64_t limit) {
+	uint64_t available = std::min<uint64_t>(this->length - this->currentPos, limit);
+	if(available == 0)
+		return 0;
+
+	const char* begin = this->data + this->currentPos;
+	const char* end = findOther(begin, this->getSymbol(), available);
+	if(end == nullptr)
+		return moveRight(this, available);
+	return moveRight(this, end - begin);
+}
+
+bool Tape::load(const std::string& filename) {
+	int descriptor = open(filename.c_str(), O_RDONLY);
+	if(descriptor < 0) {
+		std::cout << "Unable to open '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	struct stat status;
+	char last = '\0';
+	if(fstat(descriptor, &status) != 0
+		|| (status.st_size > 0 && pread(descriptor, &last, 1, status.st_size - 1) != 1)) {
+		std::cout << "Unable to read '" << filename << "'" << std::endl;
+		close(descriptor);
+		return false;
+	}
+	size_t fileSize = status.st_size;
+	size_t wordLength = last == '\n' ? fileSize - 1 : fileSize;
+
+	// a page of empty cells before the word, and the rest of its last page and another one after it
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t mapped = page + (fileSize + page - 1) / page * page + page;
+	if(mapped > UINT32_MAX) {
+		std::cout << "'" << filename << "' is too large for a tape" << std::endl;
+		close(descriptor);
+		return false;
+	}
+
+	// reserve the whole tape, then put the file into the middle of it
+	void* address = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(address == MAP_FAILED || (fileSize > 0 && mmap(static_cast<char*>(address) + page, fileSize,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, descriptor, 0) == MAP_FAILED)) {
+		std::cout << "Unable to map '" << filename << "' into memory" << std::endl;
+		if(address != MAP_FAILED)
+			munmap(address, mapped);
+		close(descriptor);
+		return false;
 	}
+	close(descriptor);
+
+	char* cells = static_cast<char*>(address);
+	memset(cells, EMPTY_SYMBOL, page);
+	memset(cells + page + wordLength, EMPTY_SYMBOL, mapped - page - wordLength);
+
+	this->release();
+	this->data = cells;
+	this->length = mapped;
+	this->currentPos = page;
+	this->origin = page;
+	this->mapping = mapped;
+	return true;
 }
 
-char Tape::getSymbol() {
-	return this->data[this->currentPos];
+bool Tape::map(const std::string& filename, uint64_t offset, uint32_t length, uint32_t head, uint32_t origin) {
+	int descriptor = open(filename.c_str(), O_RDONLY);
+	if(descriptor < 0) {
+		std::cout << "Unable to open '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	// mappings start at a page, so the cells may start a bit into the mapping
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t skip = offset % page;
+	void* address = length == 0 ? MAP_FAILED : mmap(nullptr, skip + length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		descriptor, offset - skip);
+	close(descriptor);
+	if(address == MAP_FAILED) {
+		std::cout << "Unable to map '" << filename << "' into memory" << std::endl;
+		return false;
+	}
+
+	this->release();
+	this->data = static_cast<char*>(address) + skip;
+	this->length = length;
+	this->currentPos = head;
+	this->origin = origin;
+	this->mapping = skip + length;
+	this->mappingOffset = skip;
+	return true;
 }
 
-void Tape::putSymbol(char symbol) {
-	this->data[this->currentPos] = symbol;
+bool Tape::save(const std::string& filename) const {
+	const char* first = findOther(this->data, EMPTY_SYMBOL, this->length);
+	size_t length = 0;
+	if(first != nullptr)
+		length = findLastOther(this->data, EMPTY_SYMBOL, this->length) + 1 - first;
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	file.write(first, length);
+	file.close();
+	if(!file) {
+		std::cout << "Unable to write '" << filename << "'" << std::endl;
+		return false;
+	}
+	return true;
+}
+	
+std::ostream& Tape::outputTape(std::ostream& stream) const {
+	// build the whole output first, writing it character by character is slow
+	std::string out;
+	this->render(out, 0);
+	return stream.write(out.data(), out.size());
+}
+
+void Tape::render(std::string& out, uint64_t radius) const {
+	uint64_t first = 0, last = this->length;
+	if(radius != 0) {
+		first = this->currentPos > radius ? this->currentPos - radius : 0;
+		last = std::min<uint64_t>(this->length, this->currentPos + radius + 1);
+	}
+
+	// the cells and how many of them are hidden on each side
+	size_t lineStart = out.size();
+	if(first > 0)
+		out += "<" + std::to_string(first) + " ";
+	size_t indent = out.size() - lineStart;
+	out.append(this->data + first, last - first);
+	if(last < this->length)
+		out += " " + std::to_string(this->length - last) + ">";
+	out += '\n';
+
+	// show the current position
+	out.append(indent + this->currentPos - first, ' ');
+	out += '^';
 }
 
 std::ostream& operator<<(std::ostream& stream, const Tape& tape) {
@@ -0,0 +1,135 @@
+#include <iostream>
+
+#include "include/Tape.hpp"
+#include "include/TraceRecorder.hpp"
+
+static const char TRACE_FILE_MAGIC[4] = {'T', 'M', 'T', '\n'};
+static const uint32_t TRACE_FILE_VERSION = 1;
+static const uint32_t TRACE_FILE_BYTE_ORDER = 0x01020304;
+
+// number of steps written at once
+static const size_t TRACE_BUFFER_STEPS = 1 << 16;
+
+TraceRecorder::~TraceRecorder() {
+	if(!this->file.is_open())
+		return;
+
+	// the stream may only find out about a full disk when it writes its own buffer
+	this->flush();
+	this->file.close();
+	if(!this->file)
+		this->fail();
+}
+
+bool TraceRecorder::open(const std::string& filename, const CompiledMachine& machine, const Tape* tape) {
+	this->filename = filename;
+	this->file.open(filename, std::ios::binary | std::ios::trunc);
+	if(!this->file) {
+		std::cout << "Unable to write '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	TraceHeader header = {};
+	memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_FILE_VERSION;
+	header.byteOrder = TRACE_FILE_BYTE_ORDER;
+	header.states = machine.stateCount();
+	header.start = machine.startState();
+	header.head = tape->currentPos;
+	header.tapeBytes = tape->length;
+
+	// the names are written one after another, with their offsets in front
+	std::vector<uint32_t> offsets(1, 0);
+	for(uint32_t state = 0; state < machine.stateCount(); state++)
+		offsets.push_back(offsets.back() + machine.stateName(state).size());
+	header.nameBytes = offsets.back();
+
+	this->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	this->file.write(reinterpret_cast<const char*>(offsets.data()), sizeof(uint32_t) * offsets.size());
+	for(uint32_t state = 0; state < machine.stateCount(); state++)
+		this->file.write(machine.stateName(state).data(), machine.stateName(state).size());
+	this->file.write(tape->data, tape->length);
+	if(!this->file) {
+		std::cout << "Unable to write '" << filename << "'" << std::endl;
+		this->file.close();
+		return false;
+	}
+
+	this->buffer.resize(TRACE_BUFFER_STEPS * TraceStep::BYTES);
+	this->used = 0;
+	return true;
+}
+
+void TraceRecorder::flush() {
+	if(this->used == 0 || this->failed) {
+		this->used = 0;
+		return;
+	}
+
+	this->file.write(this->buffer.data(), this->used);
+	this->used = 0;
+	if(!this->file)
+		this->fail();
+}
+
+void TraceRecorder::fail() {
+	if(this->failed)
+		return;
+
+	// the trace stays readable, it just ends before the run does
+	std::cout << "Unable to write '" << this->filename << "', the trace ends early" << std::endl;
+	this->failed = true;
+}
+
+bool Trace::open(const std::string& filename) {
+	if(!this->file.open(filename))
+		return false;
+
+	if(this->file.size() < sizeof(this->header)) {
+		std::cout << "'" << filename << "' is not a trace" << std::endl;
+		return false;
+	}
+	memcpy(&this->header, this->file.data(), sizeof(this->header));
+
+	if(memcmp(this->header.magic, TRACE_FILE_MAGIC, sizeof(this->header.magic)) != 0) {
+		std::cout << "'" << filename << "' is not a trace" << std::endl;
+		return false;
+	}
+	if(this->header.version != TRACE_FILE_VERSION || this->header.byteOrder != TRACE_FILE_BYTE_ORDER) {
+		std::cout << "'" << filename << "' was written by an incompatible version or machine" << std::endl;
+		return false;
+	}
+
+	// the steps follow the fixed size parts
+	uint64_t offsetBytes = sizeof(uint32_t) * (static_cast<uint64_t>(this->header.states) + 1);
+	uint64_t stepsStart = sizeof(this->header) + offsetBytes + this->header.nameBytes + this->header.tapeBytes;
+	if(this->file.size() < stepsStart || this->header.head >= this->header.tapeBytes) {
+		std::cout << "'" << filename << "' is damaged" << std::endl;
+		return false;
+	}
+
+	const char* data = this->file.data() + sizeof(this->header);
+	this->nameOffsets = reinterpret_cast<const uint32_t*>(data);
+	this->names = data + offsetBytes;
+	this->tape = this->names + this->header.nameBytes;
+	this->steps = this->file.data() + stepsStart;
+	// a trace of a run that was killed may end in the middle of a step
+	this->count = (this->file.size() - stepsStart) / TraceStep::BYTES;
+
+	for(uint32_t state = 0; state < this->header.states; state++) {
+		if(this->nameOffsets[state] > this->nameOffsets[state + 1]
+			|| this->nameOffsets[state + 1] > this->header.nameBytes) {
+			std::cout << "'" << filename << "' is damaged" << std::endl;
+			return false;
+		}
+	}
+	for(uint64_t i = 0; i < this->count; i++) {
+		TraceStep step = this->step(i);
+		if(step.state >= this->header.states || step.direction > Direction::STAND) {
+			std::cout << "'" << filename << "' is damaged at step " << i + 1 << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
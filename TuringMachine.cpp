@@ -1,218 +1,401 @@
 #include <algorithm>
+#include <atomic>
+#include <future>
+#include <mutex>
 #include <string>
+#include <sstream>
+#include <thread>
 #include <map>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <queue>
 #include <iostream>
 #include <iomanip> // for setw()
 #include <fstream>
-#include <regex>
 #include <filesystem>
+#include <cmath>
 
 #include "include/TuringMachine.hpp"
+#include "include/CompiledMachine.hpp"
+#include "include/MachineParser.hpp"
+#include "include/MappedFile.hpp"
+#include "include/MultiTapeMachine.hpp"
+#include "include/NondeterministicMachine.hpp"
+#include "include/Profiler.hpp"
 #include "include/Tape.hpp"
 
 namespace fs = std::filesystem;
 
-std::vector<std::string>
-split_string (std::string to_split, std::string delimiter) {
-  std::vector<std::string> result;
-  std::string s = to_split;
+/*
+ * Machine files that have been read, by their canonical path. Each entry is
+ * a future, so a file that is imported by two files at the same time is
+ * still only read once.
+ */
+struct CachedFile {
+	fs::file_time_type modified;
+	std::shared_future<std::shared_ptr<const TuringMachine>> machine;
+};
 
-  size_t pos = 0;
-  while ((pos = s.find(delimiter)) != std::string::npos) {
-    std::string token = s.substr(0, pos);
-    result.push_back(token);
-    s.erase(0, pos + delimiter.length());
-  }
+static std::mutex fileCacheLock;
+static std::map<std::string, CachedFile> fileCache;
 
-  result.push_back(s);
+// the imports of the files that are being read, to find circular imports across threads
+static std::map<std::string, std::set<std::string>> pendingImports;
+// the number of create_from_file() calls in progress; the cache is cleared after the last one
+static unsigned activeLoads = 0;
 
-  return result;
+// imports are read on threads of their own, up to one per core
+static std::atomic<unsigned> importThreads{0};
+
+// messages of files read in parallel are written as a whole
+static std::mutex outputLock;
+
+/*
+ * Check whether a file that is being read waits, directly or through its
+ * imports, for another file; needs fileCacheLock.
+ */
+static bool importsPending(const std::string& from, const std::string& to) {
+	std::vector<std::string> open = {from};
+	std::set<std::string> seen = {from};
+	while(!open.empty()) {
+		std::string file = open.back();
+		open.pop_back();
+		if(file == to)
+			return true;
+
+		auto imports = pendingImports.find(file);
+		if(imports == pendingImports.end())
+			continue;
+		for(const std::string& import : imports->second) {
+			if(seen.insert(import).second)
+				open.push_back(import);
+		}
+	}
+	return false;
 }
 
-std::vector<char>
-parse_character_class (std::string character_class) {
-  std::vector<char> result;
+TuringMachine
+TuringMachine::create_from_file (std::string filename, std::string state_prefix) {
+	TuringMachine tm;
 
-  if(character_class.size() == 0)
-    return result;
+	{
+		std::lock_guard<std::mutex> lock(fileCacheLock);
+		activeLoads++;
+	}
+	std::shared_ptr<const TuringMachine> machine = load_file(filename, {});
+	{
+		// every file is read again by the next call, so the cache does not grow for the whole process
+		std::lock_guard<std::mutex> lock(fileCacheLock);
+		if(--activeLoads == 0)
+			fileCache.clear();
+	}
+	if(machine) {
+		tm.insertMachine(*machine, state_prefix);
+		if(machine->start != "")
+			tm.start = state_prefix + machine->start;
+		tm.tapeAlphabet = machine->tapeAlphabet;
+		tm.tapes = machine->tapes;
+	}
+
+	return tm;
+}
+
+std::shared_ptr<const TuringMachine>
+TuringMachine::load_file(const std::string& filename, const std::vector<std::string>& importing) {
+	std::error_code error;
+	fs::path path = fs::weakly_canonical(filename, error);
+	if(error)
+		path = fs::absolute(filename);
+	std::string key = path.string();
 
-  if(character_class.size() == 1) {
-    result.push_back(character_class[0]);
-    return result;
-  }
+	if(std::find(importing.begin(), importing.end(), key) != importing.end()) {
+		std::lock_guard<std::mutex> lock(outputLock);
+		std::cout << filename << ": Error - the file imports itself" << std::endl;
+		return nullptr;
+	}
+
+	// files that changed since they were read are read again
+	fs::file_time_type modified = fs::last_write_time(path, error);
+
+	std::promise<std::shared_ptr<const TuringMachine>> promise;
+	{
+		std::unique_lock<std::mutex> lock(fileCacheLock);
 
-  std::vector<std::string> preresult = split_string(character_class.substr(1, character_class.size() - 2), ",");
-  for(std::string character : preresult)
-    result.push_back(character[0]);
+		// waiting for a file that waits for the importing file, maybe on another thread, would never end
+		if(!importing.empty()) {
+			if(importsPending(key, importing.back())) {
+				lock.unlock();
+				std::lock_guard<std::mutex> output(outputLock);
+				std::cout << filename << ": Error - the file imports itself" << std::endl;
+				return nullptr;
+			}
+			pendingImports[importing.back()].insert(key);
+		}
 
-  return result;
+		auto cached = fileCache.find(key);
+		if(cached != fileCache.end() && cached->second.modified == modified) {
+			auto machine = cached->second.machine;
+			lock.unlock();
+			return machine.get();
+		}
+		fileCache[key] = {modified, promise.get_future().share()};
+	}
+
+	std::vector<std::string> chain = importing;
+	chain.push_back(key);
+
+	std::shared_ptr<const TuringMachine> machine = parse_file(filename, chain);
+	{
+		std::lock_guard<std::mutex> lock(fileCacheLock);
+		pendingImports.erase(key);
+	}
+	promise.set_value(machine);
+	return machine;
 }
 
-TuringMachine
-TuringMachine::create_from_file (std::string filename, std::string state_prefix) {
-  fs::path filepath(filename);
-  if(!fs::exists(filepath)) {
-    std::cerr << "TuringMachine::create_from_file: File '" << fs::absolute(filepath) << "' does not exist" << std::endl;
-  }
 
-	std::ifstream in;
-	in.open(filename);
+std::shared_ptr<const TuringMachine>
+TuringMachine::parse_file(const std::string& filename, const std::vector<std::string>& importing) {
+	fs::path filepath(filename);
+	auto tm = std::make_shared<TuringMachine>();
 
-	TuringMachine tm;
+	if(!fs::exists(filepath)) {
+		std::cerr << "TuringMachine::create_from_file: File '" << fs::absolute(filepath) << "' does not exist" << std::endl;
+		return tm;
+	}
+
+	MappedFile file;
+	if(!file.open(filename))
+		return tm;
 
-	std::regex ruleRegEx("([a-zA-Z0-9_,]+): (\\{[^}]+\\}|[^{]),(.,)?(.) -> ([a-zA-Z0-9_]+)( #.*)?");
-	std::regex jumpRegEx("([a-zA-Z0-9_,]+): (\\{[^}]+\\}|[^{]),(.,)?jump (R|L) until (.) -> ([a-zA-Z0-9_]+)( #.*)?");
-	std::regex finalRegEx("final ([a-zA-Z0-9_]+);( #.*)?");
-	std::regex importRegEx("([a-zA-Z0-9_]+): import \"([^\"]+)\"( at ([a-zA-Z0-9_]+))? -> ([a-zA-Z0-9_]+)");
-  std::regex alphabetRegEx("alphabet (\\{.(,.)*\\});");
+	LineParser parser;
+	ParsedLine parsed;
 	int linecount = 0;
 
-	for(std::string line; std::getline(in, line);) {
+	// messages point to the file, line and column like those of a compiler
+	std::ostringstream messages;
+	auto report = [&](int line, size_t column) -> std::ostream& {
+		messages << filename << ":" << line << ":";
+		if(column != 0)
+			messages << column << ":";
+		return messages << " ";
+	};
+
+	// imports are merged after reading the whole file, so they can be read meanwhile
+	struct Import {
+		int line;
+		std::string name, entry, next;
+		std::shared_future<std::shared_ptr<const TuringMachine>> machine;
+	};
+	std::vector<Import> imports;
+	std::map<std::string, std::shared_future<std::shared_ptr<const TuringMachine>>> importedFiles;
+
+	std::string_view text(file.data(), file.size());
+	while(!text.empty()) {
+		size_t lineEnd = text.find('\n');
+		std::string_view line = text.substr(0, lineEnd);
+		text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
 		linecount++;
-		std::smatch match;
-
-		if (std::regex_match(line, match, ruleRegEx)) {
-			/* Match a rule or a collection of rules, because multiple rules can be on one line*/
-			Direction d = Direction::STAND;
-			switch(match[4].str()[0]) {
-			  case 'R': case 'r':
-			  d = Direction::RIGHT; break;
-			  case 'L': case 'l':
-			  d = Direction::LEFT; break;
-			  case 'S': case 's': break;
-			  default:
-			  std::cout << "Line " << linecount << ": unrecognized direction '" << match[4].str() << "'. Expected L, R or S" << std::endl;
-			}
 
-			std::vector<std::string> origins = split_string(match[1], ",");
-			std::vector<char> reads = parse_character_class (match[2]);
-			for (std::string origin : origins) {
-			  for(char read : reads) {
-			    char write;
-			    if(match[3].length() == 0)
-			      write = read;
-			    else
-			      write = match[3].str()[0];
-
-			    tm.addRule(state_prefix + origin, read, write, d, state_prefix + match[5].str());
-			  }
-
-			  if(tm.start == "")
-				  tm.setStart(state_prefix + match[1].str());
+		if(!parser.parse(line, &parsed)) {
+			report(linecount, parser.errorColumn()) << "syntax error: " << parser.errorMessage() << std::endl;
+			continue;
+		}
+
+		if((parsed.kind == LineKind::RULE || parsed.kind == LineKind::JUMP) && tm->tapes > 1) {
+			/* A line can hold rules for several states and every combination of the symbols of the tapes */
+			std::string target(parsed.target);
+			std::vector<Direction> directions = {parsed.direction};
+			directions.insert(directions.end(), parsed.moreDirections.begin(), parsed.moreDirections.end());
+
+			std::vector<const std::vector<char>*> symbols = {&parsed.symbols};
+			for(const std::vector<char>& more : parsed.moreSymbols)
+				symbols.push_back(&more);
+
+			std::vector<size_t> choice(symbols.size(), 0);
+			std::string reads(symbols.size(), '\0'), writes;
+			for(std::string_view origin_name : parsed.origins) {
+				std::string origin(origin_name);
+				while(true) {
+					for(size_t t = 0; t < symbols.size(); t++)
+						reads[t] = (*symbols[t])[choice[t]];
+					writes = parsed.writes ? parsed.writeSymbol + parsed.moreWrites : reads;
+					tm->addRule(origin, reads, writes, directions, target);
+
+					// the next combination, like the digits of a counter
+					size_t t = 0;
+					while(t < choice.size() && ++choice[t] == symbols[t]->size())
+						choice[t++] = 0;
+					if(t == choice.size())
+						break;
+				}
 			}
 
-    } else if(std::regex_match(line, match, jumpRegEx)) {
-			Direction d = Direction::STAND;
-			switch(match[4].str()[0]) {
-			  case 'R': case 'r':
-			  d = Direction::RIGHT; break;
-			  case 'L': case 'l':
-			  d = Direction::LEFT; break;
-			  default:
-			  std::cout << "Line " << linecount << ": unrecognized direction '" << match[4].str() << "'. Expected L or R" << std::endl;
+			if(tm->start == "")
+				tm->setStart(std::string(parsed.origins.front()));
+
+		} else if(parsed.kind == LineKind::RULE || parsed.kind == LineKind::JUMP) {
+			/* A line can hold rules for several states and symbols */
+			std::string target(parsed.target);
+			for(std::string_view origin_name : parsed.origins) {
+				std::string origin(origin_name);
+				for(char read : parsed.symbols) {
+					char write = parsed.writes ? parsed.writeSymbol : read;
+					if(parsed.kind == LineKind::JUMP)
+						tm->addJump(origin, read, write, parsed.direction, parsed.stopSymbol, target);
+					else
+						tm->addRule(origin, read, write, parsed.direction, target);
+				}
 			}
-      char jumpLimit = match[5].str()[0];
 
-			std::vector<std::string> origins = split_string(match[1], ",");
-			std::vector<char> reads = parse_character_class (match[2]);
+			if(tm->start == "")
+				tm->setStart(std::string(parsed.origins.front()));
+
+		} else if(parsed.kind == LineKind::FINAL) {
+			std::string name(parsed.origins.front());
+			tm->addState(name);
+			tm->setFinalState(name, true);
+
+			if(tm->start == "")
+				tm->setStart(name);
 
-      if(tm.tapeAlphabet.size() == 0)
-        std::cout << "Line " << linecount << ": declaring a jump before declaring the tape alphabet will result in unexpected behaviour" << std::endl;
+		} else if(parsed.kind == LineKind::IMPORT) {
+			Import import = {
+				linecount, std::string(parsed.origins.front()), std::string(parsed.importStart),
+				std::string(parsed.target), {}
+			};
+			tm->addState(import.next);
+			tm->addState(import.name);
 
-			for (std::string origin : origins) {
-			  for(char read : reads) {
-			    char write;
-			    if(match[3].length() == 0)
-			      write = read;
-			    else
-			      write = match[3].str()[0];
+			/* find the file to import */
+			std::string importfn(parsed.file);
+			fs::path importpath(importfn);
+			if(!fs::exists(importpath)) {
+				importpath = fs::path(filepath).parent_path() / importpath;
+				if(!fs::exists(importpath)) {
+					report(linecount, 0) << "Unable to find '" << importfn << "'" << std::endl;
+					break;
+				}
+			}
+
+			/* Start reading the machine, every file just once */
+			std::string importname = importpath.string();
+			if(importedFiles.count(importname) == 0) {
+				auto load = [importname, importing]() {
+					return TuringMachine::load_file(importname, importing);
+				};
+
+				if(importThreads.fetch_add(1) < std::max(1u, std::thread::hardware_concurrency())) {
+					importedFiles[importname] = std::async(std::launch::async, [load]() {
+						auto machine = load();
+						importThreads--;
+						return machine;
+					}).share();
+				} else {
+					importThreads--;
+					importedFiles[importname] = std::async(std::launch::deferred, load).share();
+				}
+			}
+			import.machine = importedFiles[importname];
+			imports.push_back(std::move(import));
 
-			    tm.addJump(state_prefix + origin, read, write, d, jumpLimit, state_prefix + match[6].str());
-			  }
+		} else if(parsed.kind == LineKind::ALPHABET) {
+			tm->setTapeAlphabet(parsed.symbols);
 
-			  if(tm.start == "")
-				  tm.setStart(state_prefix + match[1].str());
+		} else if(parsed.kind == LineKind::TAPES) {
+			if(!tm->states.empty() || !imports.empty())
+				report(linecount, 0) << "The number of tapes has to be set before any rule or import" << std::endl;
+			else {
+				tm->setTapes(parsed.tapes);
+				parser.setTapes(parsed.tapes);
 			}
+		}
+	}
+
+	/* Merge the other machines' states into this Turing Machine */
+	for(const Import& import : imports) {
+		std::shared_ptr<const TuringMachine> subMachine = import.machine.get();
+		if(!subMachine)
+			continue;
 
-		} else if(std::regex_match(line, match, finalRegEx)) {
-			tm.addState(state_prefix + match[1].str());
-			tm.setFinalState(state_prefix + match[1].str(), true);
-
-			if(tm.start == "")
-				tm.setStart(state_prefix + match[1].str());
-
-		} else if(std::regex_match(line, match, importRegEx)) {
-		  std::string subMachineName = match[1].str();
-		  std::string startState = match[4].str(), nextState = match[5].str();
-		  if(startState != "")
-		    startState = subMachineName + "__" + startState;
-		  tm.addState(nextState);
-		  tm.addState(subMachineName);
-
-		  /* find the file to import */
-		  std::string importfn = match[2].str();
-		  fs::path importpath(importfn);
-		  if(!fs::exists(importpath)) {
-		    importpath = fs::path(filepath).parent_path() / importpath;
-		    if(!fs::exists(importpath)) {
-		      std::cout << "Line " << linecount << ": Unable to find '" << importfn << "'" << std::endl;
-		      break;
-		    }
-		  }
-
-      /* Import the machine */
-		  TuringMachine subMachine = TuringMachine::create_from_file(importpath.string(), subMachineName + "__");
-		  if (startState == "")
-		    startState = subMachine.start;
-
-		  /* Merge the other machine's states into the current Turing Machine */
-		  for(const auto& [state_name, state] : subMachine.states) {
-		    std::string newname = state_name;
-		    if (state_name == startState)
-		      newname = subMachineName;
-
-		    if (state.finalState) {
-		      // the final state from the submachine will be merged with the nextState
-		      if (state.rules.size() != 0)
-		        std::cout << "Line " << linecount << ", importing '" << subMachineName << "': Error - final state '" << state_name << "' of sub machine must not have any rules" << std::endl;
-
-		      continue;
-		    }
-
-		    /* Rewrite rules, merging final states with nextState */
-		    std::vector<Rule> newrules;
-		    for (Rule rule : state.rules) {
-		      if (rule.target->finalState)
-		        tm.addRule(newname, rule.readSymbol, rule.writeSymbol, rule.direction, nextState);
-		      else if(rule.target->name == startState)
-		        tm.addRule(newname, rule.readSymbol, rule.writeSymbol, rule.direction, subMachineName);
-		      else {
-		        tm.addRule(newname, rule.readSymbol, rule.writeSymbol, rule.direction, rule.target->name);
-		      }
-		    }
-
-		    /* Insert modified state */
-		    //tm.states.insert({newname, {newname, newrules, false}});
-		  }
-    } else if(std::regex_match(line, match, alphabetRegEx)) {
-      std::vector<char> alphabet = parse_character_class(match[1].str());
-      tm.setTapeAlphabet(alphabet);
-
-		} else if(line[0] != '#' && line[0] != '\0') {
-			std::cout << "Line " << linecount << ": syntax error" << std::endl;
+		if(subMachine->tapes != tm->tapes) {
+			report(import.line, 0) << "importing '" << import.name << "': Error - the sub machine has "
+				<< subMachine->tapes << " tapes instead of " << tm->tapes << std::endl;
+			continue;
 		}
+
+		std::string startState = import.entry;
+		if(startState == "")
+			startState = subMachine->start;
+
+		for(const auto& [state_name, state] : subMachine->states) {
+			// the final states of the submachine will be merged with the next state
+			if(state.finalState && state.rules.size() != 0)
+				report(import.line, 0) << "importing '" << import.name << "': Error - final state '" << state_name << "' of sub machine must not have any rules" << std::endl;
+		}
+
+		tm->insertMachine(*subMachine, import.name + "__", startState, import.name, import.next);
+	}
+
+	if(messages.tellp() > 0) {
+		std::lock_guard<std::mutex> lock(outputLock);
+		std::cout << messages.str() << std::flush;
 	}
 
-  in.close();
 	return tm;
 }
 
+void TuringMachine::insertMachine(const TuringMachine& other, const std::string& prefix,
+																	const std::string& entry, const std::string& alias,
+																	const std::string& exit) {
+
+	// look up every state by its new name just once, rules only follow pointers
+	std::unordered_map<const State*, State*> renamed;
+	auto copyOf = [&](const State* state) {
+		auto known = renamed.find(state);
+		if(known != renamed.end())
+			return known->second;
+
+		std::string name = prefix + state->name;
+		if(exit != "" && state->finalState)
+			name = exit;
+		else if(entry != "" && state->name == entry)
+			name = alias;
+
+		auto [copy, inserted] = this->states.try_emplace(name);
+		if(inserted)
+			copy->second.name = name;
+		if(exit == "" && state->finalState)
+			copy->second.finalState = true;
+
+		renamed[state] = &copy->second;
+		return &copy->second;
+	};
+
+	for(const auto& [state_name, state] : other.states) {
+		// when merging, only states with rules of their own are needed
+		if(exit != "" && (state.finalState || state.rules.empty()))
+			continue;
+
+		State* origin = copyOf(&state);
+		for(Rule rule : state.rules) {
+			rule.target = copyOf(rule.target);
+			origin->rules.push_back(rule);
+		}
+	}
+
+	this->compiled.reset();
+}
+
 void
 TuringMachine::addState(std::string name) {
-	if(states.count(name) == 0)
+	if(states.count(name) == 0) {
 		states.insert({name, {name, {}}});
+		compiled.reset();
+	}
 }
 
 void TuringMachine::addRule(std::string origin, char readSymbol,
@@ -229,30 +412,40 @@ void TuringMachine::addRule(std::string origin, char readSymbol,
 	};
 	
 	this->states[origin].rules.push_back(rule);
+	this->compiled.reset();
+}
+
+void TuringMachine::addRule(std::string origin, const std::string& reads, const std::string& writes,
+														const std::vector<Direction>& directions, std::string target) {
+
+	addState(origin);
+	addState(target);
+
+	// the first tape is described like in machines with a single tape
+	Rule rule = {
+		reads[0], writes[0], directions[0], &this->states[target]
+	};
+	rule.moreReads = reads.substr(1);
+	rule.moreWrites = writes.substr(1);
+	rule.moreDirections.assign(directions.begin() + 1, directions.end());
+
+	this->states[origin].rules.push_back(rule);
+	this->compiled.reset();
 }
 
 void TuringMachine::addJump(std::string origin, char readSymbol, char writeSymbol, Direction direction, char stop, std::string target) {
 	
-	// create a unique name. The tm is deterministic, so origin and readsymbol should be enough
-	std::string loopName = "Loop_" + origin + '_' + readSymbol;
+	// create the origin and target states, if they don't exist yet
+	addState(origin);
+	addState(target);
 	
-	Direction reverse = Direction::STAND;
-	if (direction == Direction::LEFT) reverse = Direction::RIGHT;
-	else if (direction == Direction::RIGHT) reverse = Direction::LEFT;
+	// construct the jump; the engine takes care of moving along the tape
+	Rule rule = {
+		readSymbol, writeSymbol, direction, &this->states[target], RuleKind::JUMP, stop
+	};
 	
-	// make the machine go into a loop state
-	this->addRule(origin, readSymbol, writeSymbol, direction, loopName);
-	for (char symbol : this->tapeAlphabet) {
-		if (symbol != stop) {
-			this->addRule(loopName, symbol, symbol, direction, loopName);
-		} else {
-			// the machine should stop one cell before the symbol
-			this->addRule(loopName, stop, stop, reverse, target);
-		}
-	}
-
-  // mark the state as auxiliary to prettify graph visualization
-  states[loopName].auxiliaryState = true;
+	this->states[origin].rules.push_back(rule);
+	this->compiled.reset();
 }
 
 void TuringMachine::setFinalState(std::string name, bool finalState) {
@@ -261,185 +454,735 @@ void TuringMachine::setFinalState(std::string name, bool finalState) {
 		std::cout << "The state does not exist!" << std::endl;
 	} else {
 		this->states[name].finalState = finalState;
+		this->compiled.reset();
 	}
 	
 }
 
 void TuringMachine::setStart(std::string name) {
 	this->start = name;
+	this->compiled.reset();
 }
 
 void TuringMachine::setTapeAlphabet(std::vector<char>& tapeAlphabet) {
 	this->tapeAlphabet = tapeAlphabet;
 }
 
+bool TuringMachine::setTapes(unsigned tapes) {
+	if(!this->states.empty())
+		return false;
+	this->tapes = tapes;
+	return true;
+}
+
 void TuringMachine::reset() {
 	
 	// clear the states
 	this->states.clear();
+	this->compiled.reset();
 }
 
-bool TuringMachine::run(Tape* tape, bool showDebug) {
-	
+bool TuringMachine::compile(CompiledMachine* compiled) const {
+
 	if(this->states.count(this->start) == 0) {
 		std::cout << "No starting state found!" << std::endl;
 		return false;
 	}
-	
-	bool running = true;
-	State* currentState = &this->states[this->start];
-	
-	if(showDebug)
-		std::cout << *tape << std::endl;
-	
-	while(running) {
-		// default if no suitable rules will be found
-		running = false;
-		
-		// show more information
-		if(showDebug) {
-			std::cout << "Current state: " << currentState->name;
-			std::cout << "\n-----" << std::endl;
+
+	if(this->tapes != 1) {
+		std::cout << "The machine has " << this->tapes << " tapes and can only be run as a MultiTapeMachine" << std::endl;
+		return false;
+	}
+
+	compiled->file.reset();
+	compiled->finalStateData.clear();
+	compiled->nameOffsetData.assign(1, 0);
+	compiled->nameData.clear();
+
+	// states get the next free id
+	auto addState = [&](const std::string& name, bool final) {
+		uint32_t id = compiled->finalStateData.size();
+		compiled->finalStateData.push_back(final);
+		compiled->nameData.insert(compiled->nameData.end(), name.begin(), name.end());
+		compiled->nameOffsetData.push_back(compiled->nameData.size());
+		return id;
+	};
+
+	// number the states densely in the order of their names
+	std::unordered_map<std::string, uint32_t> ids;
+	for(const auto& [state_name, state] : this->states)
+		ids[state_name] = addState(state_name, state.finalState);
+	compiled->start = ids[this->start];
+
+	// fill the table; symbols without a rule halt the machine
+	compiled->tableData.assign(compiled->finalStateData.size() * CompiledMachine::SYMBOLS,
+														Transition{0, 0, 0, TransitionKind::HALT, 0});
+
+	// jumps with the same direction, stop symbol and target share a scan state
+	std::map<std::tuple<Direction, char, uint32_t>, uint32_t> scanStates;
+	auto scanState = [&](const std::string& name, Direction direction, char stop, uint32_t target) {
+		auto key = std::make_tuple(direction, stop, target);
+		if(scanStates.count(key) != 0)
+			return scanStates[key];
+
+		uint32_t id = addState(name, false);
+		scanStates[key] = id;
+
+		Direction reverse = Direction::STAND;
+		if (direction == Direction::LEFT) reverse = Direction::RIGHT;
+		else if (direction == Direction::RIGHT) reverse = Direction::LEFT;
+
+		// keep moving over every symbol but the stop symbol
+		for(uint32_t symbol = 0; symbol < CompiledMachine::SYMBOLS; symbol++) {
+			char c = static_cast<char>(symbol);
+			if(c == stop) {
+				// the machine should stop one cell before the symbol
+				compiled->tableData.push_back({target, stop, static_cast<uint8_t>(reverse), TransitionKind::MOVE, 0});
+			} else {
+				uint8_t kind = direction == Direction::STAND ? TransitionKind::MOVE : TransitionKind::SCAN;
+				compiled->tableData.push_back({id, c, static_cast<uint8_t>(direction), kind, stop});
+			}
 		}
-		
-		// search for a suitable rule to apply
-		for(auto rule : currentState->rules) {
-			if(rule.readSymbol == tape->getSymbol()) {
-				
-				// apply the rule
-				tape->putSymbol(rule.writeSymbol);
-				
-				if(rule.direction == Direction::LEFT) {
-					tape->stepLeft();
-				} else if (rule.direction == Direction::RIGHT) {
-					tape->stepRight();
-				} else {
-					// do nothing, standing still
-				}
-				
-				currentState = rule.target;
-				
-				// show the current state (tape)
-				if(showDebug)
-					std::cout << *tape << std::endl;
-
-				running = true;
-				break; // TODO: Replace that nasty break
+		return id;
+	};
+
+	bool deterministic = true;
+	for(const auto& [state_name, state] : this->states) {
+		uint32_t id = ids[state_name];
+
+		for(const Rule& rule : state.rules) {
+			size_t index = id * CompiledMachine::SYMBOLS + static_cast<unsigned char>(rule.readSymbol);
+			if(compiled->tableData[index].kind != TransitionKind::HALT) {
+				std::cout << "State '" << state_name << "' has more than one rule for symbol '"
+									<< rule.readSymbol << "'" << std::endl;
+				deterministic = false;
+				continue;
+			}
+
+			Transition entry = {
+				ids[rule.target->name], rule.writeSymbol, static_cast<uint8_t>(rule.direction),
+				TransitionKind::MOVE, 0
+			};
+
+			if(rule.kind == RuleKind::JUMP) {
+				// a jump first moves into a state that scans for the stop symbol
+				entry.target = scanState("Loop_" + state_name + '_' + rule.readSymbol,
+																rule.direction, rule.stopSymbol, entry.target);
+			} else if(entry.target == id && rule.writeSymbol == rule.readSymbol
+								&& rule.direction != Direction::STAND) {
+				// rules that just move on in the same state can be applied to whole runs
+				entry.kind = TransitionKind::SWEEP;
 			}
+
+			compiled->tableData[index] = entry;
 		}
 	}
-	
-	if(currentState->finalState)
-		return true;
-	
-	return false;
+
+	compiled->useStorage();
+	return deterministic;
 }
 
-bool TuringMachine::step(Tape* tape) {
-	
+bool TuringMachine::compile(NondeterministicMachine* compiled) const {
+
 	if(this->states.count(this->start) == 0) {
 		std::cout << "No starting state found!" << std::endl;
 		return false;
 	}
-	
-	bool running = true;
-	State* currentState = &this->states[this->start];
-	
-	std::cout << *tape << std::endl;
-	
-	while(running) {
-		// default if no suitable rules will be found
-		running = false;
-		
-		// wait for user input
-		std::cout << "Current state: " << currentState->name;
-		std::cout << "\n-----" << std::flush;
-		std::cin.get();
-		
-		// search for a suitable rule to apply
-		for(auto rule : currentState->rules) {
-			if(rule.readSymbol == tape->getSymbol()) {
-				
-				// apply the rule
-				tape->putSymbol(rule.writeSymbol);
-				
-				if(rule.direction == Direction::LEFT) {
-					tape->stepLeft();
-				} else if (rule.direction == Direction::RIGHT) {
-					tape->stepRight();
-				} else {
-					// do nothing, standing still
-				}
-				
-				currentState = rule.target;
-				
-				// show the current state (tape)
-				std::cout << *tape << std::endl;
-				running = true;
-				break;
+
+	if(this->tapes != 1) {
+		std::cout << "Only machines with a single tape can be searched" << std::endl;
+		return false;
+	}
+
+	compiled->finalStates.clear();
+	compiled->names.clear();
+
+	auto addState = [&](const std::string& name, bool final) {
+		uint32_t id = compiled->finalStates.size();
+		compiled->finalStates.push_back(final);
+		compiled->names.push_back(name);
+		return id;
+	};
+
+	// number the states like compile(CompiledMachine*) does
+	std::unordered_map<std::string, uint32_t> ids;
+	for(const auto& [state_name, state] : this->states)
+		ids[state_name] = addState(state_name, state.finalState);
+	compiled->start = ids[this->start];
+
+	// the choices of each state and symbol, flattened below
+	std::vector<std::vector<Transition>> choices(compiled->finalStates.size() * CompiledMachine::SYMBOLS);
+
+	// jumps scan for their stop symbol in a state of their own, one cell per step
+	std::map<std::tuple<Direction, char, uint32_t>, uint32_t> scanStates;
+	auto scanState = [&](const std::string& name, Direction direction, char stop, uint32_t target) {
+		auto key = std::make_tuple(direction, stop, target);
+		if(scanStates.count(key) != 0)
+			return scanStates[key];
+
+		uint32_t id = addState(name, false);
+		scanStates[key] = id;
+		choices.resize(choices.size() + CompiledMachine::SYMBOLS);
+
+		Direction reverse = Direction::STAND;
+		if (direction == Direction::LEFT) reverse = Direction::RIGHT;
+		else if (direction == Direction::RIGHT) reverse = Direction::LEFT;
+
+		for(uint32_t symbol = 0; symbol < CompiledMachine::SYMBOLS; symbol++) {
+			char c = static_cast<char>(symbol);
+			Transition entry = c == stop
+				? Transition{target, stop, static_cast<uint8_t>(reverse), TransitionKind::MOVE, 0}
+				: Transition{id, c, static_cast<uint8_t>(direction), TransitionKind::MOVE, 0};
+			choices[id * CompiledMachine::SYMBOLS + symbol].push_back(entry);
+		}
+		return id;
+	};
+
+	for(const auto& [state_name, state] : this->states) {
+		uint32_t id = ids[state_name];
+
+		for(const Rule& rule : state.rules) {
+			Transition entry = {
+				ids[rule.target->name], rule.writeSymbol, static_cast<uint8_t>(rule.direction),
+				TransitionKind::MOVE, 0
+			};
+			if(rule.kind == RuleKind::JUMP)
+				entry.target = scanState("Loop_" + state_name + '_' + rule.readSymbol,
+																rule.direction, rule.stopSymbol, entry.target);
+
+			choices[id * CompiledMachine::SYMBOLS + static_cast<unsigned char>(rule.readSymbol)].push_back(entry);
+		}
+	}
+
+	compiled->firstChoice.clear();
+	compiled->choices.clear();
+	for(const std::vector<Transition>& list : choices) {
+		compiled->firstChoice.push_back(compiled->choices.size());
+		compiled->choices.insert(compiled->choices.end(), list.begin(), list.end());
+	}
+	compiled->firstChoice.push_back(compiled->choices.size());
+
+	return true;
+}
+
+bool TuringMachine::compile(MultiTapeMachine* compiled) const {
+
+	if(this->states.count(this->start) == 0) {
+		std::cout << "No starting state found!" << std::endl;
+		return false;
+	}
+
+	// every symbol that is read gets an index, all others share the last one
+	bool read[CompiledMachine::SYMBOLS] = {};
+	for(const auto& [state_name, state] : this->states) {
+		for(const Rule& rule : state.rules) {
+			if(rule.kind == RuleKind::JUMP) {
+				std::cout << "State '" << state_name << "' has a jump, which is only possible on a single tape" << std::endl;
+				return false;
 			}
+			read[static_cast<unsigned char>(rule.readSymbol)] = true;
+			for(char symbol : rule.moreReads)
+				read[static_cast<unsigned char>(symbol)] = true;
 		}
 	}
-	
-	if(currentState->finalState)
-		return true;
-	
-	return false;
+
+	uint32_t symbols = 0;
+	for(uint32_t symbol = 0; symbol < CompiledMachine::SYMBOLS; symbol++) {
+		if(read[symbol])
+			compiled->symbolIndex[symbol] = symbols++;
+	}
+	for(uint32_t symbol = 0; symbol < CompiledMachine::SYMBOLS; symbol++) {
+		if(!read[symbol])
+			compiled->symbolIndex[symbol] = symbols;
+	}
+	compiled->symbols = symbols + 1;
+	compiled->tapes = this->tapes;
+
+	compiled->columns = 1;
+	for(unsigned t = 0; t < this->tapes; t++) {
+		compiled->columns *= compiled->symbols;
+		if(compiled->columns * this->states.size() > MultiTapeMachine::MAX_ENTRIES) {
+			std::cout << "The machine reads too many different symbols on its " << this->tapes
+								<< " tapes to build its table" << std::endl;
+			return false;
+		}
+	}
+
+	// number the states densely in the order of their names
+	std::unordered_map<std::string, uint32_t> ids;
+	compiled->finalStates.clear();
+	compiled->names.clear();
+	for(const auto& [state_name, state] : this->states) {
+		ids[state_name] = compiled->finalStates.size();
+		compiled->finalStates.push_back(state.finalState);
+		compiled->names.push_back(state_name);
+	}
+	compiled->start = ids[this->start];
+
+	size_t entries = compiled->columns * this->states.size();
+	compiled->targets.assign(entries, MultiTapeMachine::HALT);
+	compiled->writes.assign(entries * this->tapes, 0);
+	compiled->directions.assign(entries * this->tapes, 0);
+
+	bool deterministic = true;
+	for(const auto& [state_name, state] : this->states) {
+		for(const Rule& rule : state.rules) {
+			std::string reads = rule.readSymbol + rule.moreReads;
+			std::string writes = rule.writeSymbol + rule.moreWrites;
+
+			// the symbol of the first tape is the lowest digit of the column
+			size_t column = 0;
+			for(size_t t = reads.size(); t-- > 0;)
+				column = column * compiled->symbols + compiled->symbolIndex[static_cast<unsigned char>(reads[t])];
+			size_t entry = ids[state_name] * compiled->columns + column;
+
+			if(compiled->targets[entry] != MultiTapeMachine::HALT) {
+				std::cout << "State '" << state_name << "' has more than one rule for symbols '";
+				for(size_t t = 0; t < reads.size(); t++)
+					std::cout << (t > 0 ? "|" : "") << reads[t];
+				std::cout << "'" << std::endl;
+				deterministic = false;
+				continue;
+			}
+
+			compiled->targets[entry] = ids[rule.target->name];
+			for(size_t t = 0; t < this->tapes; t++) {
+				compiled->writes[entry * this->tapes + t] = writes[t];
+				Direction direction = t == 0 ? rule.direction : rule.moreDirections[t - 1];
+				compiled->directions[entry * this->tapes + t] = static_cast<uint8_t>(direction);
+			}
+		}
+	}
+
+	return deterministic;
+}
+
+const CompiledMachine* TuringMachine::getCompiled() {
+
+	if(!this->compiled) {
+		auto machine = std::make_shared<CompiledMachine>();
+		if(!this->compile(machine.get()))
+			return nullptr;
+
+		this->compiled = machine;
+	}
+
+	return this->compiled.get();
 }
 
+bool TuringMachine::run(Tape* tape, bool showDebug) {
+
+	const CompiledMachine* machine = this->getCompiled();
+	if(machine == nullptr)
+		return false;
+
+	return machine->run(tape, showDebug);
+}
+
+RunResult TuringMachine::run(Tape* tape, const RunOptions& options) {
+
+	const CompiledMachine* machine = this->getCompiled();
+	if(machine == nullptr) {
+		RunResult result;
+		result.reason = HaltReason::INVALID_MACHINE;
+		return result;
+	}
+
+	return machine->run(tape, options);
+}
+
+bool TuringMachine::step(Tape* tape) {
+
+	const CompiledMachine* machine = this->getCompiled();
+	if(machine == nullptr)
+		return false;
+
+	return machine->step(tape);
+}
+
+/* the symbols of a rule on all of its tapes, like "a|b" */
+static std::string symbolTuple(char first, const std::string& more) {
+	std::string result(1, first);
+	for (char symbol : more) {
+		result += '|';
+		result += symbol;
+	}
+	return result;
+}
+
+bool
+TuringMachine::graph_to_file (std::string filename, const Profiler* profile) {
+	GraphOptions options;
+	options.profile = profile;
+	return this->graph_to_file(filename, options);
+}
+
+// the machine a state was imported from at the top level, or an empty string
+static std::string importOf(const std::string& name, const std::unordered_set<std::string>& imports) {
+	size_t end = name.find("__");
+	if(end != std::string::npos)
+		return name.substr(0, end);
+	// the entry of an import is named like the import itself
+	return imports.count(name) != 0 ? name : "";
+}
+
+// size of the buffer graphs are written through
+static const size_t GRAPH_BUFFER_BYTES = 1 << 20;
+
 bool
-TuringMachine::graph_to_file (std::string filename) {
-	std::ofstream out(filename, std::ios::trunc);
-	out << "digraph G {" << std::endl;
-	out << "  ___start [label=start;shape=none;fontcolor=red];" << std::endl;
-	out << "  ___start -> " << start << ";" << std::endl;
+TuringMachine::graph_to_file (std::string filename, const GraphOptions& options) {
+	const Profiler* profile = options.profile;
 
-	/* iterate over states */
+	// a large buffer, lines are never flushed on their own
+	std::vector<char> buffer(GRAPH_BUFFER_BYTES);
+	std::ofstream out;
+	out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+	out.open(filename, std::ios::trunc);
+
+	/* number the states densely in the order of their names */
+	std::vector<const State*> byId;
+	std::unordered_map<const State*, uint32_t> ids;
 	for(const auto& [state_name, state] : states) {
-		if (state.finalState)
-			out << "  " << state_name << " [shape=doublecircle];" << std::endl;
-		else if (state.auxiliaryState)
-      out << "  " << state_name << " [color=gray];" << std::endl;
-    else
-			out << "  " << state_name << ";" << std::endl;
+		ids[&state] = byId.size();
+		byId.push_back(&state);
 	}
+	uint32_t count = byId.size();
 
-	/* iterate over states again for rules */
-	for(const auto& [state_name, state] : states) {
-	  /* iterate over destination states to merge rules that lead the same way to one label */
-	  std::map<std::string, std::vector<Rule>> rules_by_target;
-	  for (Rule rule : state.rules) {
-	    if (rules_by_target.count(rule.target->name) == 0){
-	      std::vector<Rule> rules {rule};
-	      rules_by_target.insert({rule.target->name, rules});
-	    } else {
-	      std::vector<Rule> *rules = &rules_by_target[rule.target->name];
-	      rules->push_back(rule);
-	    }
-	  }
-
-		for (const auto& [target_state_name, rules] : rules_by_target) {
-			out << "  " << state_name << " -> " << target_state_name << " [label=\"";
-			for (Rule rule : rules) {
-			  out << rule.readSymbol << "/" << rule.writeSymbol << "/";
-			  switch(rule.direction) {
-			    case Direction::LEFT:
-  				out << "L"; break;
-  				case Direction::RIGHT:
-  				out << "R"; break;
-  				case Direction::STAND:
-  				out << "S"; break;
-  			}
-	  		out << " \\n";
-	  	}
-	  	out << "\"];" << std::endl;
+	/* steps of every state in the profile; the scans of jumps count for their state */
+	std::vector<uint32_t> profileIds(count, 0);
+	std::vector<uint64_t> steps(count, 0);
+	uint64_t busiest = 0;
+	if (profile != nullptr) {
+		for (uint32_t id = 0; id < count; id++) {
+			const State& state = *byId[id];
+			profileIds[id] = profile->stateId(state.name);
+			steps[id] = profile->stateSteps(profileIds[id]) + profile->jumpSteps(profileIds[id]);
+			busiest = std::max(busiest, steps[id]);
+		}
+	}
+
+	/* colour from blue for unused to red for the busiest, on a logarithmic scale */
+	auto heat = [&](uint64_t steps) {
+		return busiest == 0 ? 0.0 : std::log(steps + 1.0) / std::log(busiest + 1.0);
+	};
+	auto colour = [&](uint64_t steps) {
+		std::ostringstream hsv;
+		hsv << std::fixed << std::setprecision(3) << 0.66 * (1 - heat(steps)) << " 0.6 1";
+		return hsv.str();
+	};
+
+	/* pick the busiest states, or the ones the start state reaches first */
+	std::vector<bool> shown(count, options.maxStates == 0);
+	uint32_t hidden = 0;
+	if (options.maxStates != 0) {
+		std::vector<uint32_t> order;
+		if (profile != nullptr) {
+			for (uint32_t id = 0; id < count; id++)
+				order.push_back(id);
+			std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+				return steps[a] > steps[b];
+			});
+		} else {
+			for (const State* state : this->reachableStates())
+				order.push_back(ids[state]);
+		}
+		for (size_t i = 0; i < order.size() && i < options.maxStates; i++)
+			shown[order[i]] = true;
+		hidden = count - std::min<size_t>(order.size(), options.maxStates);
+	}
+
+	/* imported machines, which may be drawn as boxes or as single nodes */
+	std::unordered_set<std::string> prefixes;
+	for (const State* state : byId) {
+		size_t end = state->name.find("__");
+		if (end != std::string::npos)
+			prefixes.insert(state->name.substr(0, end));
+	}
+	std::vector<std::string> imports;
+	std::unordered_map<std::string, uint32_t> importIds;
+	std::vector<uint32_t> importOfState(count, UINT32_MAX);
+	if (options.clusters || options.collapseImports) {
+		for (uint32_t id = 0; id < count; id++) {
+			std::string import = importOf(byId[id]->name, prefixes);
+			if (import.empty())
+				continue;
+			auto [known, inserted] = importIds.try_emplace(import, imports.size());
+			if (inserted)
+				imports.push_back(import);
+			importOfState[id] = known->second;
 		}
 	}
+
+	/* every state is drawn as a node of its own, as the node of its import or not at all */
+	const uint32_t MORE_NODE = count + imports.size();
+	std::vector<std::string> nodeNames;
+	for (const State* state : byId)
+		nodeNames.push_back(state->name);
+	nodeNames.insert(nodeNames.end(), imports.begin(), imports.end());
+	nodeNames.push_back("___more");
+
+	auto nodeOf = [&](uint32_t id) {
+		if (!shown[id])
+			return MORE_NODE;
+		if (options.collapseImports && importOfState[id] != UINT32_MAX)
+			return count + importOfState[id];
+		return id;
+	};
+
+	out << "digraph G {\n";
+	if (this->states.count(this->start) != 0 && shown[ids[&this->states[this->start]]]) {
+		out << "  ___start [label=start;shape=none;fontcolor=red];\n";
+		out << "  ___start -> " << nodeNames[nodeOf(ids[&this->states[this->start]])] << ";\n";
+	}
+
+	auto writeState = [&](uint32_t id, const char* indent) {
+		const State& state = *byId[id];
+		out << indent << state.name;
+		if (profile != nullptr) {
+			out << " [label=\"" << state.name << "\\n" << steps[id] << "\";style=filled;fillcolor=\""
+					<< colour(steps[id]) << "\"";
+			if (state.finalState)
+				out << ";shape=doublecircle";
+			out << "];\n";
+		} else if (state.finalState)
+			out << " [shape=doublecircle];\n";
+		else
+			out << ";\n";
+	};
+
+	/* the states, grouped by their imports if wanted */
+	std::vector<std::vector<uint32_t>> members(imports.size());
+	std::vector<uint64_t> importSteps(imports.size(), 0);
+	for (uint32_t id = 0; id < count; id++) {
+		if (shown[id] && importOfState[id] != UINT32_MAX) {
+			members[importOfState[id]].push_back(id);
+			importSteps[importOfState[id]] += steps[id];
+		}
+	}
+	// collapsed imports are coloured like states
+	if (options.collapseImports && !importSteps.empty())
+		busiest = std::max(busiest, *std::max_element(importSteps.begin(), importSteps.end()));
+
+	for (uint32_t id = 0; id < count; id++) {
+		if (shown[id] && importOfState[id] == UINT32_MAX)
+			writeState(id, "  ");
+	}
+	for (size_t import = 0; import < imports.size(); import++) {
+		if (members[import].empty())
+			continue;
+
+		if (options.collapseImports) {
+			out << "  " << imports[import] << " [label=\"" << imports[import] << "\\n(" << members[import].size()
+					<< " states";
+			if (profile != nullptr)
+				out << ", " << importSteps[import] << " steps)\";style=filled;fillcolor=\"" << colour(importSteps[import]);
+			else
+				out << ")";
+			out << "\";shape=box3d];\n";
+			continue;
+		}
+
+		out << "  subgraph \"cluster_" << imports[import] << "\" {\n";
+		out << "    label=\"" << imports[import] << "\";\n";
+		for (uint32_t id : members[import])
+			writeState(id, "    ");
+		out << "  }\n";
+	}
+	if (hidden > 0)
+		out << "  ___more [label=\"" << hidden << " more states\";shape=none];\n";
+
+	/* the rules, with the rules that lead from the same node to the same node on one edge */
+	struct Edge {
+		uint32_t from, to, state;
+		const Rule* rule;
+	};
+	std::vector<Edge> edges;
+	for (uint32_t id = 0; id < count; id++) {
+		if (!shown[id])
+			continue;
+		for (const Rule& rule : byId[id]->rules) {
+			uint32_t from = nodeOf(id), to = nodeOf(ids[rule.target]);
+			// the insides of collapsed imports are not shown
+			if (from == to && from >= count)
+				continue;
+			edges.push_back({from, to, id, &rule});
+		}
+	}
+	std::stable_sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+		return a.from != b.from ? a.from < b.from : a.to < b.to;
+	});
+
+	for (size_t first = 0; first < edges.size();) {
+		size_t last = first;
+		while (last < edges.size() && edges[last].from == edges[first].from && edges[last].to == edges[first].to)
+			last++;
+
+		out << "  " << nodeNames[edges[first].from] << " -> " << nodeNames[edges[first].to];
+		if (edges[first].to == MORE_NODE) {
+			// the rules into hidden states are not worth their labels
+			out << " [style=dashed];\n";
+			first = last;
+			continue;
+		}
+
+		out << " [label=\"";
+		uint64_t edgeSteps = 0;
+		for (size_t e = first; e < last; e++) {
+			const Rule& rule = *edges[e].rule;
+			out << symbolTuple(rule.readSymbol, rule.moreReads) << "/"
+					<< symbolTuple(rule.writeSymbol, rule.moreWrites) << "/" << rule.direction;
+			for (Direction direction : rule.moreDirections)
+				out << "|" << direction;
+			if (rule.kind == RuleKind::JUMP)
+				out << " until " << rule.stopSymbol;
+			if (profile != nullptr) {
+				uint64_t count = profile->ruleCount(profileIds[edges[e].state], rule.readSymbol);
+				out << " (" << count << ")";
+				edgeSteps += count;
+			}
+			out << " \\n";
+		}
+		out << "\"";
+		if (profile != nullptr) {
+			out << ";color=\"" << colour(edgeSteps) << "\";penwidth=" << std::fixed << std::setprecision(2)
+					<< 1 + 4 * heat(edgeSteps);
+		}
+		out << "];\n";
+		first = last;
+	}
 	out << "}";
+	out.close();
 
+	if (!out) {
+		std::cout << "Unable to write '" << filename << "'" << std::endl;
+		return false;
+	}
 	return true;
 }
 
+std::vector<State*> TuringMachine::reachableStates() {
+	auto start = this->states.find(this->start);
+	if(start == this->states.end())
+		return {};
+
+	std::vector<State*> order(1, &start->second);
+	std::unordered_set<const State*> seen(order.begin(), order.end());
+
+	// the order doubles as the queue of the search
+	for(size_t next = 0; next < order.size(); next++) {
+		for(const Rule& rule : order[next]->rules) {
+			if(seen.insert(rule.target).second)
+				order.push_back(rule.target);
+		}
+	}
+
+	return order;
+}
+
+MinimizeResult TuringMachine::minimize() {
+	MinimizeResult result;
+	result.statesBefore = this->states.size();
+
+	std::vector<State*> reachable = this->reachableStates();
+	if(reachable.empty())
+		return result;
+
+	std::unordered_map<const State*, uint32_t> index;
+	for(uint32_t i = 0; i < reachable.size(); i++)
+		index[reachable[i]] = i;
+
+	// number what the rules do apart from their targets
+	std::map<std::string, uint32_t> labelIds;
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> rules(reachable.size());
+	for(uint32_t i = 0; i < reachable.size(); i++) {
+		for(const Rule& rule : reachable[i]->rules) {
+			std::string label = {rule.readSymbol, rule.writeSymbol, static_cast<char>(rule.direction),
+				static_cast<char>(rule.kind), rule.kind == RuleKind::JUMP ? rule.stopSymbol : '\0'};
+			label += rule.moreReads + '|' + rule.moreWrites + '|';
+			for(Direction direction : rule.moreDirections)
+				label += static_cast<char>(direction);
+
+			auto id = labelIds.try_emplace(label, labelIds.size()).first->second;
+			rules[i].push_back({id, index[rule.target]});
+		}
+	}
+
+	// start with final and other states, then split groups until their rules agree
+	std::vector<uint32_t> group(reachable.size());
+	for(uint32_t i = 0; i < reachable.size(); i++)
+		group[i] = reachable[i]->finalState ? 1 : 0;
+
+	size_t groups = 0;
+	while(true) {
+		std::map<std::vector<uint32_t>, uint32_t> signatures;
+		std::vector<uint32_t> refined(reachable.size());
+		for(uint32_t i = 0; i < reachable.size(); i++) {
+			std::vector<std::pair<uint32_t, uint32_t>> moves;
+			for(auto [label, target] : rules[i])
+				moves.push_back({label, group[target]});
+			std::sort(moves.begin(), moves.end());
+
+			std::vector<uint32_t> signature(1, group[i]);
+			for(auto [label, target] : moves) {
+				signature.push_back(label);
+				signature.push_back(target);
+			}
+			refined[i] = signatures.try_emplace(signature, signatures.size()).first->second;
+		}
+
+		group = std::move(refined);
+		if(signatures.size() == groups)
+			break;
+		groups = signatures.size();
+	}
+
+	// every group is represented by the start state or its first name
+	std::vector<State*> representative(groups, nullptr);
+	representative[group[0]] = reachable[0];
+	for(auto& [name, state] : this->states) {
+		auto found = index.find(&state);
+		if(found != index.end() && representative[group[found->second]] == nullptr)
+			representative[group[found->second]] = &state;
+	}
+
+	for(State* state : representative) {
+		for(Rule& rule : state->rules)
+			rule.target = representative[group[index[rule.target]]];
+
+		// merged targets may turn alternatives of nondeterministic machines into duplicates
+		std::vector<Rule> unique;
+		for(const Rule& rule : state->rules) {
+			bool duplicate = false;
+			for(const Rule& other : unique) {
+				duplicate = duplicate || (other.readSymbol == rule.readSymbol && other.writeSymbol == rule.writeSymbol
+					&& other.direction == rule.direction && other.target == rule.target && other.kind == rule.kind
+					&& other.stopSymbol == rule.stopSymbol && other.moreReads == rule.moreReads
+					&& other.moreWrites == rule.moreWrites && other.moreDirections == rule.moreDirections);
+			}
+			if(!duplicate)
+				unique.push_back(rule);
+		}
+		state->rules = std::move(unique);
+	}
+
+	// drop every state that is neither reachable nor represents its group
+	for(auto it = this->states.begin(); it != this->states.end();) {
+		auto found = index.find(&it->second);
+		if(found == index.end()) {
+			result.unreachable++;
+			it = this->states.erase(it);
+		} else if(representative[group[found->second]] != &it->second) {
+			result.merged++;
+			it = this->states.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	this->compiled.reset();
+	return result;
+}
+
 std::ostream& TuringMachine::outputMachine(std::ostream& stream) {
 	
 	// state | read | write | direction | nextState
@@ -452,7 +1195,7 @@ std::ostream& TuringMachine::outputMachine(std::ostream& stream) {
 	size_t longest = CURRENT_STATE.length();
 	if(NEXT_STATE.length() > longest)
 		longest = NEXT_STATE.length();
-	for(auto pair : this->states) {
+	for(const auto& pair : this->states) {
 		if(pair.first.length() > longest)
 			longest = pair.first.length();
 	}
@@ -468,37 +1211,10 @@ std::ostream& TuringMachine::outputMachine(std::ostream& stream) {
 	}
 	stream << "\n";
 	
-	// calculate the right order (TODO: Memory?)
-	std::vector<std::string> orderedNames;
-	std::queue<State> toSearch;
-	// TODO: test for (invalid) tm without start
-	toSearch.push(this->states[this->start]);
-	
-	while(!toSearch.empty()) {
-		
-		State current = toSearch.front();
-		toSearch.pop();
-		// append the name if it does not already exist
-		if (std::find(orderedNames.begin(), 
-			orderedNames.end(), current.name) == orderedNames.end()) {
-			
-			orderedNames.push_back(current.name);
-		}
-		
-		
-		for(auto& rule : current.rules) {
-			if (std::find(orderedNames.begin(), 
-				orderedNames.end(), rule.target->name) == orderedNames.end()) {
-					
-				toSearch.push(*rule.target);
-			}
-		}
-	}
-	
-	// simple version: unordered
-	for(auto& name : orderedNames) {
+	// show the states in the order they are reached
+	for(const State* state : this->reachableStates()) {
 		
-		State current = this->states[name];
+		const State& current = *state;
 		
 		// iterate through the rules
 		for(auto it = current.rules.begin();
@@ -518,7 +1234,16 @@ std::ostream& TuringMachine::outputMachine(std::ostream& stream) {
 				stream << std::setw(longest) << displayName << " | ";
 				stream << it->readSymbol << " | " << it->writeSymbol << " | ";
 				stream << it->direction << " | "; 
-				stream << std::setw(longest) << it->target->name << "\n";
+				stream << std::setw(longest) << it->target->name;
+				if(!it->moreReads.empty()) {
+					stream << " (other tapes: " << it->moreReads << " | " << it->moreWrites << " | ";
+					for(Direction direction : it->moreDirections)
+						stream << direction;
+					stream << ")";
+				}
+				if(it->kind == RuleKind::JUMP)
+					stream << " (jump until " << it->stopSymbol << ")";
+				stream << "\n";
 			}
 		
 		/* 
@@ -568,3 +1293,29 @@ std::ostream& operator<<(std::ostream& stream,
 	
 	return stream;
 }
+std::ostream& operator<<(std::ostream& stream,
+											const HaltReason& reason) {
+
+	switch(reason) {
+		case HaltReason::HALTED:
+		stream << "halted"; break;
+		case HaltReason::STEP_LIMIT:
+		stream << "step limit reached"; break;
+		case HaltReason::TAPE_LIMIT:
+		stream << "tape limit reached"; break;
+		case HaltReason::TIMEOUT:
+		stream << "timed out"; break;
+		case HaltReason::INVALID_MACHINE:
+		stream << "invalid machine"; break;
+		case HaltReason::CYCLE:
+		stream << "runs forever"; break;
+		case HaltReason::FRONTIER_LIMIT:
+		stream << "frontier limit reached"; break;
+		case HaltReason::MEMORY_LIMIT:
+		stream << "memory limit reached"; break;
+		case HaltReason::STOPPED:
+		stream << "stopped"; break;
+	}
+
+	return stream;
+}
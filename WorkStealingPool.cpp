@@ -0,0 +1,114 @@
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "include/WorkStealingPool.hpp"
+
+// the range of task numbers a single thread still has to work on
+struct WorkRange {
+	std::mutex lock;
+	size_t begin = 0;
+	size_t end = 0;
+};
+
+WorkStealingPool::WorkStealingPool(unsigned threads) : threads(threads) {
+	if(this->threads == 0)
+		this->threads = std::thread::hardware_concurrency();
+	if(this->threads == 0)
+		this->threads = 1;
+}
+
+// take the next task of a thread's own range
+static bool take(WorkRange& range, size_t* task) {
+	std::lock_guard<std::mutex> guard(range.lock);
+	if(range.begin == range.end)
+		return false;
+
+	*task = range.begin++;
+	return true;
+}
+
+// move the upper half of the fullest other range into the thread's own range
+static bool steal(std::vector<WorkRange>& ranges, size_t thief) {
+	while(true) {
+		// find the victim with the most remaining tasks
+		size_t victim = thief, remaining = 0;
+		for(size_t i = 0; i < ranges.size(); i++) {
+			if(i == thief)
+				continue;
+
+			std::lock_guard<std::mutex> guard(ranges[i].lock);
+			if(ranges[i].end - ranges[i].begin > remaining) {
+				remaining = ranges[i].end - ranges[i].begin;
+				victim = i;
+			}
+		}
+
+		if(remaining == 0)
+			return false;
+
+		// the victim may have made progress in the meantime, so check again
+		size_t begin, end;
+		{
+			std::lock_guard<std::mutex> guard(ranges[victim].lock);
+			remaining = ranges[victim].end - ranges[victim].begin;
+			if(remaining == 0)
+				continue;
+
+			end = ranges[victim].end;
+			begin = end - (remaining + 1) / 2;
+			ranges[victim].end = begin;
+		}
+
+		std::lock_guard<std::mutex> guard(ranges[thief].lock);
+		ranges[thief].begin = begin;
+		ranges[thief].end = end;
+		return true;
+	}
+}
+
+void WorkStealingPool::run(size_t count, const std::function<void(size_t)>& task) const {
+	this->runOnThreads(count, [&task](size_t next, unsigned) {
+		task(next);
+	});
+}
+
+void WorkStealingPool::runOnThreads(size_t count, const std::function<void(size_t, unsigned)>& task) const {
+
+	size_t threadCount = this->threads;
+	if(threadCount > count)
+		threadCount = count;
+
+	if(threadCount <= 1) {
+		for(size_t i = 0; i < count; i++)
+			task(i, 0);
+		return;
+	}
+
+	// hand out equal shares of the tasks
+	std::vector<WorkRange> ranges(threadCount);
+	for(size_t i = 0; i < threadCount; i++) {
+		ranges[i].begin = count * i / threadCount;
+		ranges[i].end = count * (i + 1) / threadCount;
+	}
+
+	auto worker = [&ranges, &task](unsigned id) {
+		size_t next;
+		while(true) {
+			if(take(ranges[id], &next))
+				task(next, id);
+			else if(!steal(ranges, id))
+				break;
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for(size_t i = 1; i < threadCount; i++)
+		workers.emplace_back(worker, i);
+
+	// the calling thread does its share as well
+	worker(0);
+
+	for(std::thread& t : workers)
+		t.join();
+}
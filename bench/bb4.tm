@@ -0,0 +1,11 @@
+# The 4-state busy beaver champion (Brady): 107 steps, writes 13 ones
+# on a blank tape. Blank cells are read as 0.
+A: _,1,R -> B
+A: 1,1,L -> B
+B: _,1,L -> A
+B: 1,_,L -> C
+C: _,1,R -> H
+C: 1,1,L -> D
+D: _,1,R -> D
+D: 1,_,R -> A
+final H;
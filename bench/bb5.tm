@@ -0,0 +1,13 @@
+# The 5-state busy beaver champion (Marxen and Buntrock): 47,176,870 steps,
+# writes 4098 ones on a blank tape. Blank cells are read as 0.
+A: _,1,R -> B
+A: 1,1,L -> C
+B: _,1,R -> C
+B: 1,1,R -> B
+C: _,1,R -> D
+C: 1,_,L -> E
+D: _,1,L -> A
+D: 1,1,L -> D
+E: _,1,R -> H
+E: 1,_,L -> A
+final H;
@@ -0,0 +1,14 @@
+# Sweeps back and forth over a word of 1s, marking the innermost 1 on each
+# side as x, until all of them are marked. Takes about n^2 steps for n 1s,
+# almost all of them moving along runs of the same symbol.
+Right: {1,x},R -> Right
+Right: _,L -> MarkRight
+MarkRight: x,L -> MarkRight
+MarkRight: 1,x,L -> Left
+MarkRight: _,R -> Done
+Left: {1,x},L -> Left
+Left: _,R -> MarkLeft
+MarkLeft: x,R -> MarkLeft
+MarkLeft: 1,x,R -> Right
+MarkLeft: _,L -> Done
+final Done;
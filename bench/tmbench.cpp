@@ -0,0 +1,177 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../include/CompiledMachine.hpp"
+#include "../include/RunLengthTape.hpp"
+#include "../include/Tape.hpp"
+#include "../include/TuringMachine.hpp"
+
+using namespace std;
+
+/*
+ * tmbench runs a set of reference workloads in every engine mode and prints
+ * the results as JSON, so results of different versions can be compared.
+ */
+
+// every allocation of the program is counted
+static atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size) {
+	allocations++;
+	if(void* memory = malloc(size == 0 ? 1 : size))
+		return memory;
+	throw bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	free(memory);
+}
+
+struct Workload {
+	string name;
+	// relative to the root of the repository
+	string machine;
+	string input;
+	// the number of steps every mode has to take, to catch wrong results
+	uint64_t steps;
+};
+
+vector<Workload> workloads() {
+	return {
+		{"bb4", "bench/bb4.tm", "", 107},
+		{"bb5", "bench/bb5.tm", "", 47176870},
+		{"sweep", "bench/sweep.tm", string(3000, '1'), 9009002},
+		{"collatz", "demo/collatz.tm", string(100, '1'), 3590713},
+		{"times3", "demo/times3.tm", string(100000, '1'), 200004},
+		{"unary_subtract", "demo/unary_subtract.tm", string(3000, '1') + "#" + string(1500, '1'), 11266504},
+	};
+}
+
+const char* MODES[] = {"plain", "packed", "rle", "cycles"};
+
+RunResult runOnce(const CompiledMachine& machine, const string& input, const string& mode) {
+	RunOptions options;
+	if(mode == "rle") {
+		RunLengthTape tape(input.c_str());
+		return machine.run(&tape, options);
+	}
+	if(mode == "packed")
+		return machine.runPacked(input.c_str(), options);
+
+	options.detectCycles = mode == "cycles";
+	Tape tape(input.c_str());
+	return machine.run(&tape, options);
+}
+
+// a string as a JSON value
+string quoted(const string& text) {
+	string result = "\"";
+	for(char c : text) {
+		if(c == '"' || c == '\\')
+			result += '\\';
+		result += c;
+	}
+	return result + "\"";
+}
+
+void printHelp() {
+	cout << "Run the reference workloads and print the results as JSON" << endl;
+	cout << "Invocation:" << endl;
+	cout << "  tmbench [options] [root]" << endl;
+	cout << "Where root is the directory with demo/ and bench/, the current directory by default" << endl;
+	cout << "Possible options:" << endl;
+	cout << "  --repeat N: Run each workload N times and report the fastest run (default 3)" << endl;
+	cout << "  --only NAME: Run only the workload with this name" << endl;
+	cout << "  --mode MODE: Run only in this mode: plain, packed, rle or cycles" << endl;
+}
+
+int main(int argc, char** argv) {
+	string root = ".", only, onlyMode;
+	unsigned repeat = 3;
+
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--help") == 0) {
+			printHelp();
+			return 0;
+		} else if(i + 1 < argc && strcmp(argv[i], "--repeat") == 0)
+			repeat = max(1ul, strtoul(argv[++i], nullptr, 10));
+		else if(i + 1 < argc && strcmp(argv[i], "--only") == 0)
+			only = argv[++i];
+		else if(i + 1 < argc && strcmp(argv[i], "--mode") == 0)
+			onlyMode = argv[++i];
+		else
+			root = argv[i];
+	}
+
+	bool failed = false, first = true;
+	cout << "{\n  \"version\": 1,\n  \"repeat\": " << repeat << ",\n  \"results\": [";
+
+	for(const Workload& workload : workloads()) {
+		if(!only.empty() && workload.name != only)
+			continue;
+
+		// reading and compiling the machine
+		uint64_t allocationsBefore = allocations;
+		auto loadStart = chrono::steady_clock::now();
+		TuringMachine tm = TuringMachine::create_from_file(root + "/" + workload.machine);
+		CompiledMachine machine;
+		if(!tm.compile(&machine)) {
+			cerr << "Unable to compile " << workload.machine << endl;
+			failed = true;
+			continue;
+		}
+		chrono::duration<double> loadTime = chrono::steady_clock::now() - loadStart;
+		uint64_t loadAllocations = allocations - allocationsBefore;
+
+		for(const char* mode : MODES) {
+			if(!onlyMode.empty() && onlyMode != mode)
+				continue;
+
+			RunResult best;
+			uint64_t runAllocations = 0;
+			for(unsigned round = 0; round < repeat; round++) {
+				allocationsBefore = allocations;
+				RunResult result = runOnce(machine, workload.input, mode);
+				if(round == 0 || result.elapsed < best.elapsed) {
+					best = result;
+					runAllocations = allocations - allocationsBefore;
+				}
+			}
+
+			if(best.reason != HaltReason::HALTED || best.steps != workload.steps) {
+				cerr << workload.name << " (" << mode << "): expected to halt after " << workload.steps
+						<< " steps, but took " << best.steps << " (" << best.reason << ")" << endl;
+				failed = true;
+			}
+
+			double seconds = best.elapsed.count();
+			cout << (first ? "\n" : ",\n");
+			first = false;
+			cout << "    {\"workload\": " << quoted(workload.name)
+					<< ", \"machine\": " << quoted(workload.machine)
+					<< ", \"input_cells\": " << workload.input.size()
+					<< ", \"mode\": " << quoted(mode)
+					<< ", \"accepted\": " << (best.accepted ? "true" : "false")
+					<< ", \"steps\": " << best.steps
+					<< ", \"seconds\": " << seconds
+					<< ", \"steps_per_second\": " << (seconds > 0 ? best.steps / seconds : 0)
+					<< ", \"peak_tape_cells\": " << best.peakTapeSize
+					<< ", \"load_seconds\": " << loadTime.count()
+					<< ", \"load_allocations\": " << loadAllocations
+					<< ", \"run_allocations\": " << runAllocations << "}";
+		}
+	}
+
+	cout << "\n  ]\n}" << endl;
+	return failed ? 1 : 0;
+}
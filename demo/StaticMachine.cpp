@@ -2,44 +2,48 @@
 #include <cstring>
 
 #include "../include/Tape.hpp"
-#include "../include/TuringMachine.hpp"
+#include "../include/StaticMachine.hpp"
 
 const char EMP = Tape::EMPTY_SYMBOL;
 const Direction L = Direction::LEFT;
 const Direction R = Direction::RIGHT;
 
-int main() {
-		
-	TuringMachine tm;
-	
-	/* determine if there is an even number of 1s on the tape */
-	
-	// first character is the result as a bool: 0 -> not even, 1 -> even 
-	tm.addRule("S1", EMP, '1', R, "F2");
-	tm.addRule("S1", '1', '0', R, "S2");
-	
+/* determine if there is an even number of 1s on the tape */
+constexpr StaticRule evenOnes[] = {
+	// first character is the result as a bool: 0 -> not even, 1 -> even
+	{"S1", EMP, '1', R, "F2"},
+	{"S1", '1', '0', R, "S2"},
+
 	// find the next 1 on the tape
-	tm.addRule("S2", '1', '#', L, "S3");
-	tm.addRule("S2", '#', '#', R, "S2");
-	tm.addRule("S2", EMP, EMP, L, "F1");
-	
+	{"S2", '1', '#', L, "S3"},
+	{"S2", '#', '#', R, "S2"},
+	{"S2", EMP, EMP, L, "F1"},
+
 	// go back to switch the first character
-	tm.addRule("S3", '#', '#', L, "S3");
-	tm.addRule("S3", '1', '0', R, "S2");
-	tm.addRule("S3", '0', '1', R, "S2");
-	
+	{"S3", '#', '#', L, "S3"},
+	{"S3", '1', '0', R, "S2"},
+	{"S3", '0', '1', R, "S2"},
+
 	// clean up after operation
-	tm.addRule("F1", '#', EMP, L, "F1");
-	tm.addRule("F1", '1', '1', R, "F2");
-	tm.addRule("F1", '0', '0', R, "F2");
-	
+	{"F1", '#', EMP, L, "F1"},
+	{"F1", '1', '1', R, "F2"},
+	{"F1", '0', '0', R, "F2"},
+
 	// go back to the beginning
-	tm.addRule("F2", EMP, EMP, L, "F3");
-	
-	tm.setStart("S1");
-	tm.setFinalState("F3");
-	
+	{"F2", EMP, EMP, L, "F3"},
+};
+
+constexpr const char* evenOnesFinal[] = {"F3"};
+
+// the machine is checked and its table is built while compiling
+using EvenOnes = StaticMachine<evenOnes, evenOnesFinal>;
+
+int main() {
+
 	Tape tape("1111");
-	tm.step(&tape);
+	RunResult result = EvenOnes::run(&tape);
 
+	std::cout << tape << std::endl;
+	std::cout << (result.accepted ? "accepted" : "not accepted")
+						<< " after " << result.steps << " steps" << std::endl;
 }
@@ -31,7 +31,7 @@ MoveLeft1: _,L -> MoveLeft1
 MoveLeft1: {0,1},S -> CheckFinished
 
 # Done: Move right to where the index is
-Done: {0,1_},R -> Done
+Done: {0,1},R -> Done
 Done: _,R -> Done
 Done: $,R -> Done1
 final Done1;
@@ -0,0 +1,12 @@
+# Accepts words over {0,1} whose third symbol from the end is a 1.
+# The machine guesses where that symbol is, so it is nondeterministic:
+# run it with --nondeterministic.
+
+Guess: {0,1},R -> Guess
+Guess: 1,R -> Second
+
+Second: {0,1},R -> First
+First: {0,1},R -> End
+End: _,L -> Accept
+
+final Accept;
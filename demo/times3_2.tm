@@ -0,0 +1,25 @@
+# Compute the product of three with a given binary number, like times3.tm
+# but by adding the number to twice the number on a second tape.
+
+tapes 2;
+
+# Copy the number to the second tape, with a 0 appended to double it
+S: 0|_,0|0,R|R -> S
+S: 1|_,1|1,R|R -> S
+S: _|_,_|0,L|S -> C0
+
+# Add both tapes from the right, the states C0 and C1 represent the carry.
+# The result replaces the number on the first tape, which is the shorter one.
+C0: {0,_}|0,0|0,L|L -> C0
+C0: {0,_}|1,1|1,L|L -> C0
+C0: 1|0,1|0,L|L -> C0
+C0: 1|1,0|1,L|L -> C1
+C0: _|_,R|R -> E
+
+C1: {0,_}|0,1|0,L|L -> C0
+C1: {0,_}|1,0|1,L|L -> C1
+C1: 1|0,0|0,L|L -> C1
+C1: 1|1,1|1,L|L -> C1
+C1: _|_,1|_,S|S -> E
+
+final E;
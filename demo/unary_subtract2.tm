@@ -0,0 +1,16 @@
+# Given two unary numbers separated by '#', calculate their difference,
+# like unary_subtract.tm but with a second tape for the result.
+# A single pass over the input is enough, instead of going back and forth.
+
+tapes 2;
+
+# Copy the first number to the second tape
+Copy: 1|_,_|1,R|R -> Copy
+Copy: #|_,_|_,R|L -> Cancel
+
+# Cancel one digit of the copy for every digit of the second number
+Cancel: 1|1,_|_,R|L -> Cancel
+
+# The rest of the copy is the difference
+Cancel: _|{1,_},S|S -> Done
+final Done;
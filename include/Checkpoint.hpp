@@ -0,0 +1,165 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CompiledMachine.hpp"
+#include "MappedFile.hpp"
+#include "Tape.hpp"
+
+/*
+ * Layout of checkpoint files: the header, padded to a whole page, followed by
+ * the cells of the tape, so the tape starts at a page boundary and can be used
+ * right from a mapped file. All numbers are stored in the byte order of the
+ * machine that wrote them.
+ *
+ * Checkpoints after the first only write the pages of the tape that changed.
+ * They are first written into a journal next to the file, which is only
+ * applied to the file once it is complete, so the file always holds one
+ * complete checkpoint, even if the process is killed while writing.
+ */
+struct CheckpointHeader {
+	char magic[4];
+	uint32_t version;
+	// tells apart files from machines with another byte order
+	uint32_t byteOrder;
+	uint32_t state;
+	// tells whether the checkpoint belongs to a machine, see machineHash()
+	uint64_t machine;
+	uint64_t steps;
+	uint32_t length;
+	// the position of the head on the tape
+	uint32_t head;
+	// the position of the first cell of the input on the tape
+	uint32_t origin;
+};
+
+/**
+ * Saves the configuration of a run into a checkpoint file every few seconds.
+ *
+ * The engine reports after every block of steps how far the head may have
+ * moved, so the writer knows which pages of the tape may have changed without
+ * looking at every step. Only these pages are written, unless the tape grew,
+ * which moves its cells and happens rarely.
+ */
+class CheckpointWriter {
+
+public:
+
+	// size of the pages of the tape that are written as a whole
+	static const uint32_t PAGE = 4096;
+
+private:
+
+	std::string filename;
+	uint64_t machine = 0;
+	std::chrono::steady_clock::duration interval{0};
+	std::chrono::steady_clock::time_point next;
+
+	// the pages of the tape that may have changed since the last checkpoint
+	std::vector<bool> dirty;
+	uint32_t length = 0;
+
+	bool writeAll(const Tape* tape, uint32_t state, uint64_t steps);
+	bool writeDirty(const Tape* tape, uint32_t state, uint64_t steps);
+
+public:
+
+	/**
+	 * Write a first checkpoint of the configuration a run starts at.
+	 *
+	 * @param filename	The file to keep the checkpoints in
+	 * @param interval	Seconds between two checkpoints
+	 * @param machine		The machine that runs
+	 * @param tape			The tape the run starts on
+	 * @param state			The state the run starts in
+	 * @param steps			The steps the run made before
+	 *
+	 * @return false if the file could not be written
+	 */
+	bool open(const std::string& filename, double interval, const CompiledMachine& machine,
+						const Tape* tape, uint32_t state, uint64_t steps);
+
+	/**
+	 * Note a block of steps and write a checkpoint if it is due.
+	 *
+	 * @param tape		The tape after the block
+	 * @param state		The state after the block
+	 * @param steps		The steps of the run so far
+	 * @param moved		The number of steps in the block, which the head moved at most
+	 */
+	inline void afterBlock(const Tape* tape, uint32_t state, uint64_t steps, uint64_t moved);
+
+	/**
+	 * Write a checkpoint now.
+	 *
+	 * @return false if the checkpoint could not be written
+	 */
+	bool save(const Tape* tape, uint32_t state, uint64_t steps);
+};
+
+/**
+ * A checkpoint file to resume a run from.
+ */
+class Checkpoint {
+
+private:
+
+	std::string filename;
+	MappedFile file;
+	const CheckpointHeader* header = nullptr;
+
+public:
+
+	/**
+	 * Map a checkpoint, completing a checkpoint that was interrupted
+	 * while it was written, if its journal is complete.
+	 *
+	 * @param filename	The checkpoint file
+	 * @param machine		The machine the run should continue with
+	 *
+	 * @return false if the file is no valid checkpoint of the machine
+	 */
+	bool open(const std::string& filename, const CompiledMachine& machine);
+
+	uint32_t state() const {
+		return this->header->state;
+	}
+
+	uint64_t steps() const {
+		return this->header->steps;
+	}
+
+	/**
+	 * Put the tape of the checkpoint onto a tape, with its head and origin.
+	 * The cells are mapped copy on write right from the file, see Tape::map().
+	 *
+	 * @param tape		The tape to replace the contents of
+	 *
+	 * @return false if the file could not be mapped
+	 */
+	bool restore(Tape* tape) const {
+		return tape->map(this->filename, CheckpointWriter::PAGE, this->header->length, this->header->head,
+			this->header->origin);
+	}
+};
+
+/**
+ * A hash of the transition table and the state names of a machine,
+ * to make sure a checkpoint is resumed with the same machine.
+ */
+uint64_t machineHash(const CompiledMachine& machine);
+
+inline void CheckpointWriter::afterBlock(const Tape* tape, uint32_t state, uint64_t steps, uint64_t moved) {
+	// the cells written in the block are at most moved cells away from the head
+	uint64_t head = tape->currentPos;
+	uint64_t first = head > moved ? head - moved : 0;
+	uint64_t last = head + moved;
+	for(uint64_t page = first / PAGE; page <= last / PAGE && page < this->dirty.size(); page++)
+		this->dirty[page] = true;
+
+	if(std::chrono::steady_clock::now() >= this->next)
+		this->save(tape, state, steps);
+}
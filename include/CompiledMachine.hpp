@@ -0,0 +1,291 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "TuringMachine.hpp"
+
+class Tape;
+class RunLengthTape;
+template<unsigned BITS> class PackedTape;
+
+/**
+ * The kinds of entries in a compiled transition table.
+ */
+enum TransitionKind : uint8_t {
+	// there is no rule for the symbol, the machine halts
+	HALT = 0,
+	// an ordinary rule
+	MOVE,
+	// a rule that keeps the symbol, moves and stays in the same state, so it
+	// is applied again and again for as long as the same symbol is read
+	SWEEP,
+	// a sweep over all symbols except the stop symbol, as used by jumps
+	SCAN
+};
+
+/**
+ * One entry of the compiled transition table, i.e. what to do when
+ * a certain state reads a certain symbol.
+ */
+struct Transition {
+	// dense id of the state to continue in
+	uint32_t target;
+	char writeSymbol;
+	// a Direction, stored in a single byte to keep the entry small
+	uint8_t direction;
+	// a TransitionKind
+	uint8_t kind;
+	// for SCAN transitions: the symbol that ends the scan
+	char stopSymbol;
+};
+
+// compiled machines are saved by writing the table as it is
+static_assert(sizeof(Transition) == 8, "Transitions are stored in files with 8 bytes each");
+
+/**
+ * An immutable, flattened form of a TuringMachine.
+ *
+ * States are numbered densely and the transitions are kept in a single
+ * table with one row per state and one column per possible symbol, so
+ * executing a step is a single lookup instead of a search through the
+ * rules of a state.
+ * Jump rules get an additional state that scans the tape for the stop
+ * symbol, which the engine executes without interpreting each cell.
+ * Instances are created by TuringMachine::compile(), loaded from a
+ * file written by save() or built rule by rule with reset() and
+ * setTransition(), which is how machines are enumerated.
+ * Running only reads the machine, so one instance can be shared by
+ * threads that run it on different tapes.
+ */
+class CompiledMachine {
+
+	friend class TuringMachine;
+
+public:
+
+	// number of columns per state: one for every possible byte on the tape
+	static const uint32_t SYMBOLS = 256;
+
+private:
+
+	// the machine; points either into the storage below or into a mapped file
+	const Transition* table = nullptr;
+	const uint8_t* finalStates = nullptr;
+	// where the name of each state starts in names, followed by the end of the last one
+	const uint32_t* nameOffsets = nullptr;
+	const char* names = nullptr;
+	uint32_t states = 0;
+	uint32_t start = 0;
+
+	// storage of a machine compiled in memory: stateCount() * SYMBOLS
+	// transitions, indexed by state id and symbol, and the names of the states
+	std::vector<Transition> tableData;
+	std::vector<uint8_t> finalStateData;
+	std::vector<uint32_t> nameOffsetData;
+	std::vector<char> nameData;
+
+	// the file a loaded machine is mapped from
+	std::unique_ptr<MappedFile> file;
+
+	// how many entries of the table read or write each symbol, see alphabet()
+	std::array<uint64_t, SYMBOLS> symbolUses = {};
+
+	/**
+	 * Point the machine to its storage after compiling it in memory.
+	 */
+	void useStorage();
+
+	/**
+	 * Count the symbols of the whole table, or add or remove those of one entry.
+	 */
+	void countSymbols();
+	void countSymbols(uint64_t entry, int64_t uses);
+
+public:
+
+	CompiledMachine() = default;
+	CompiledMachine(CompiledMachine&&) = default;
+	CompiledMachine& operator=(CompiledMachine&&) = default;
+
+	/**
+	 * Look up what the machine does when reading a symbol in a state.
+	 *
+	 * @param state		Dense id of the current state
+	 * @param symbol	The symbol under the head
+	 */
+	inline const Transition& lookup(uint32_t state, char symbol) const {
+		return this->table[state * SYMBOLS + static_cast<unsigned char>(symbol)];
+	}
+
+	uint32_t stateCount() const {
+		return this->states;
+	}
+
+	uint32_t startState() const {
+		return this->start;
+	}
+
+	std::string_view stateName(uint32_t state) const {
+		return std::string_view(this->names + this->nameOffsets[state],
+														this->nameOffsets[state + 1] - this->nameOffsets[state]);
+	}
+
+	bool isFinal(uint32_t state) const {
+		return this->finalStates[state] != 0;
+	}
+
+	/**
+	 * Get the symbols the machine reads or writes, without the empty symbol.
+	 * They are counted whenever the table changes, so this is cheap.
+	 *
+	 * @return the symbols in the order of their codes
+	 */
+	std::string alphabet() const;
+
+	/**
+	 * Replace the machine by one without any transitions, which halts right
+	 * away. The states are named A, B, ..., Z, then Q26, Q27, ...
+	 *
+	 * @param states	Number of states
+	 * @param start		Dense id of the start state
+	 */
+	void reset(uint32_t states, uint32_t start = 0);
+
+	/**
+	 * Set what the machine does when reading a symbol in a state, replacing
+	 * the transition there was. Only possible for machines in memory, i.e. not
+	 * for machines loaded from a file; the machine must not run meanwhile.
+	 *
+	 * @param state				Dense id of the state
+	 * @param symbol			The symbol read
+	 * @param writeSymbol	The symbol to write
+	 * @param direction		The direction to move to
+	 * @param target			Dense id of the state to continue in
+	 */
+	void setTransition(uint32_t state, char symbol, char writeSymbol, Direction direction, uint32_t target);
+
+	/**
+	 * Set a transition as it is, e.g. one taken from lookup() of another machine.
+	 */
+	void setTransition(uint32_t state, char symbol, const Transition& transition);
+
+	/**
+	 * Let the machine halt when reading a symbol in a state.
+	 */
+	void clearTransition(uint32_t state, char symbol);
+
+	/**
+	 * Replace the machine by a copy of another one, which is kept in memory
+	 * even if the other one was loaded from a file, so its transitions can
+	 * be changed.
+	 *
+	 * @param other		The machine to copy
+	 */
+	void copy(const CompiledMachine& other);
+
+	/**
+	 * Write the machine into a binary file, which can be loaded much
+	 * faster than parsing the machine and its imports again.
+	 * The file is only meant for machines with the same byte order.
+	 *
+	 * @param filename	Path to the file to write
+	 *
+	 * @return false if the file could not be written
+	 */
+	bool save(const std::string& filename) const;
+
+	/**
+	 * Load a machine written by save(), replacing this machine.
+	 * The file is mapped into memory and used as it is.
+	 *
+	 * @param filename	Path to the file to load
+	 *
+	 * @return false if the file could not be read or is no valid machine
+	 */
+	bool load(const std::string& filename);
+
+	/**
+	 * Run the machine on a given input.
+	 *
+	 * @param tape			Pointer to the input tape
+	 * @param showDebug	Show the tape after each step
+	 *
+	 * @return true if program ended on a final state
+	 */
+	bool run(Tape* tape, bool showDebug = false) const;
+
+	/**
+	 * Run the machine on a given input, respecting the given limits.
+	 *
+	 * @param tape		Pointer to the input tape
+	 * @param options	Limits for the run
+	 *
+	 * @return why the machine stopped, along with statistics about the run
+	 */
+	RunResult run(Tape* tape, const RunOptions& options) const;
+
+	/**
+	 * Run the machine on a run length encoded tape. Sweeping rules cross
+	 * the whole run of symbols under the head in a single operation, while
+	 * still being counted as one step per cell. Cycles are not detected
+	 * and no trace is recorded.
+	 *
+	 * @param tape		Pointer to the input tape
+	 * @param options	Limits for the run
+	 *
+	 * @return why the machine stopped, along with statistics about the run
+	 */
+	RunResult run(RunLengthTape* tape, const RunOptions& options) const;
+
+	/**
+	 * Run the machine on a tape with packed cells, see PackedTape. Sweeping
+	 * and scanning rules look at whole words of cells at once. Cycles are
+	 * not detected, no trace is recorded and no checkpoints are saved.
+	 *
+	 * @param tape		Pointer to the input tape, holding all symbols of alphabet()
+	 * @param options	Limits for the run
+	 *
+	 * @return why the machine stopped, along with statistics about the run
+	 */
+	template<unsigned BITS>
+	RunResult run(PackedTape<BITS>* tape, const RunOptions& options) const;
+
+	/**
+	 * Run the machine on a PackedTape with as few bits per cell as the
+	 * symbols of the machine and the input need, or on a Tape if there
+	 * are more than SymbolAlphabet::MAX_SYMBOLS of them.
+	 *
+	 * @param input		Input to the machine
+	 * @param options	Limits for the run
+	 *
+	 * @return why the machine stopped, along with statistics about the run
+	 */
+	RunResult runPacked(const char* input, const RunOptions& options) const;
+
+	/**
+	 * Run the machine on a given input; execute just one step at a time,
+	 * waiting for cin.get and showing the current state of the machine.
+	 *
+	 * @param tape		Pointer to the input tape
+	 *
+	 * @return true if program ended on a final state
+	 */
+	bool step(Tape* tape) const;
+
+	/**
+	 * Run the machine one step at a time like step(Tape*), showing the
+	 * tape as set in the options; every input runs options.debugInterval steps.
+	 *
+	 * @param tape		Pointer to the input tape
+	 * @param options	How to show the tape; limits do not apply
+	 *
+	 * @return true if program ended on a final state
+	 */
+	bool step(Tape* tape, const RunOptions& options) const;
+};
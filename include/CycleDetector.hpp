@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "CompiledMachine.hpp"
+#include "TuringMachine.hpp"
+
+class Tape;
+
+/**
+ * Watches a run on a Tape step by step and proves that the machine never halts.
+ *
+ * Two kinds of cycles are detected:
+ *  - The same state and tape content relative to the head repeat
+ *    (Brent's algorithm on configuration hashes). This includes machines
+ *    that move their whole tape content along.
+ *  - The head breaks its record on one side of the tape twice in the same
+ *    state, with the same tape content behind it, as far back as the head
+ *    went in between. Everything beyond a record is blank, so the machine
+ *    repeats itself shifted along the tape forever, leaving garbage behind.
+ *
+ * Both are only reported once they have been verified on the actual tape
+ * content, so hash collisions never lead to wrong results.
+ */
+class CycleDetector {
+
+public:
+
+	static const bool EACH_STEP = true;
+
+private:
+
+	// tape content with positions relative to the input
+	struct Snapshot {
+		std::string cells;
+		// position of the first cell in cells
+		int64_t first = 0;
+		int64_t head = 0;
+		uint32_t state = 0;
+		uint64_t step = 0;
+
+		char at(int64_t position) const;
+	};
+
+	// a record of the head on one side of the tape
+	struct Record {
+		bool valid = false;
+		Snapshot snapshot;
+		// how far the head went back from the record since it was taken
+		int64_t excursion = 0;
+		uint64_t lastCompare = 0;
+		uint64_t interval = 1;
+	};
+
+	uint64_t steps = 0;
+
+	// position of the head relative to where it started
+	int64_t head = 0;
+
+	// rolling hash over the tape and powers of its base for the head position
+	uint64_t tapeHash = 0;
+	uint64_t power = 1;
+	uint64_t inversePower = 1;
+
+	// the configuration to compare against in Brent's algorithm
+	Snapshot checkpoint;
+	uint64_t checkpointHash = 0;
+	uint64_t nextCheckpoint = 1;
+
+	// furthest positions the head or the input reached; 0 is right, 1 is left
+	int64_t extreme[2];
+	Record records[2];
+
+public:
+
+	/**
+	 * Start watching a run.
+	 *
+	 * @param tape		The tape the run starts on
+	 * @param state		The state the run starts in
+	 */
+	CycleDetector(const Tape* tape, uint32_t state);
+
+	/**
+	 * Look at the configuration after a step.
+	 *
+	 * @param tape				The tape after the step
+	 * @param state				The state after the step
+	 * @param read				The symbol the step read
+	 * @param transition	The transition that was applied
+	 *
+	 * @return false if the machine was proven to never halt
+	 */
+	bool afterStep(const Tape* tape, uint32_t state, char read, const Transition& transition);
+
+	HaltReason stopReason() const {
+		return HaltReason::CYCLE;
+	}
+
+private:
+
+	char cellAt(const Tape* tape, int64_t position) const;
+	Snapshot takeSnapshot(const Tape* tape, uint32_t state) const;
+	uint64_t configurationHash(uint32_t state) const;
+
+	/**
+	 * Check whether the configuration equals the snapshot, up to a shift.
+	 */
+	bool sameConfiguration(const Snapshot& snapshot, const Tape* tape, uint32_t state) const;
+
+	/**
+	 * Handle the head breaking its record on one side.
+	 *
+	 * @return false if a translated cycle was found
+	 */
+	bool checkRecord(int side, const Tape* tape, uint32_t state);
+};
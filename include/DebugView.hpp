@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "TuringMachine.hpp"
+
+/**
+ * Shows the configurations of a run in debug mode. Every frame is built in
+ * a single buffer and written at once, and frames are skipped to show only
+ * every few steps or at most a few frames per second.
+ *
+ * Machines need to provide stateName(), tapes need to provide render().
+ */
+template<class Machine>
+class DebugView {
+
+	const Machine& machine;
+	const RunOptions& options;
+	std::string frame;
+	std::chrono::steady_clock::duration frameTime{0};
+	std::chrono::steady_clock::time_point nextFrame;
+	uint64_t shownStep = 0;
+
+public:
+
+	DebugView(const Machine& machine, const RunOptions& options)
+		: machine(machine), options(options) {
+		if(options.debugFrameRate > 0)
+			this->frameTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double>(1 / options.debugFrameRate));
+	}
+
+	// show the configuration after a step, unless the frame is skipped
+	template<class TapeType>
+	inline void afterStep(const TapeType* tape, uint32_t state, uint64_t step) {
+		if(this->options.debugInterval > 1 && step % this->options.debugInterval != 0)
+			return;
+		// reading the clock costs more than a step, so it is only done every few steps
+		if(this->frameTime.count() != 0
+			&& (step % 256 != 0 || std::chrono::steady_clock::now() < this->nextFrame))
+			return;
+		this->show(tape, state, step);
+	}
+
+	// show the last configuration of a run, if it was skipped
+	template<class TapeType>
+	void finish(const TapeType* tape, uint32_t state, uint64_t step) {
+		if(step != this->shownStep)
+			this->show(tape, state, step);
+	}
+
+	template<class TapeType>
+	void show(const TapeType* tape, uint32_t state, uint64_t step) {
+		this->frame.clear();
+		this->frame += "Step ";
+		this->frame += std::to_string(step);
+		this->frame += ", state ";
+		this->frame += this->machine.stateName(state);
+		this->frame += '\n';
+		tape->render(this->frame, this->options.debugWindow);
+		this->frame += "\n-----\n";
+
+		std::cout.write(this->frame.data(), this->frame.size());
+		std::cout.flush();
+
+		this->shownStep = step;
+		if(this->frameTime.count() != 0)
+			this->nextFrame = std::chrono::steady_clock::now() + this->frameTime;
+	}
+};
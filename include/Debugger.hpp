@@ -0,0 +1,181 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CompiledMachine.hpp"
+#include "Tape.hpp"
+#include "TuringMachine.hpp"
+
+/**
+ * Stops a run when the head reaches one of some cells or the symbol in one
+ * of some cells changes. Cells are counted from the first cell of the
+ * input, to the left with negative numbers.
+ */
+class Watchpoints {
+
+public:
+
+	static const bool EACH_STEP = true;
+
+	// cells to stop at when the head reaches them
+	std::vector<int64_t> positions;
+	// cells to stop at when their symbol changes
+	std::vector<int64_t> cells;
+
+	// the cell that stopped the run, and whether it was written
+	int64_t hit = 0;
+	bool written = false;
+
+	inline bool afterStep(const Tape* tape, uint32_t, char read, const Transition& transition) {
+		int64_t head = static_cast<int64_t>(tape->currentPos) - tape->origin;
+		for(int64_t position : this->positions) {
+			if(position == head) {
+				this->hit = head;
+				this->written = false;
+				return false;
+			}
+		}
+
+		if(transition.writeSymbol == read)
+			return true;
+
+		// the symbol was written before the head moved
+		int64_t cell = head;
+		if(transition.direction == Direction::LEFT)
+			cell++;
+		else if(transition.direction == Direction::RIGHT)
+			cell--;
+		for(int64_t watched : this->cells) {
+			if(watched == cell) {
+				this->hit = cell;
+				this->written = true;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	HaltReason stopReason() const {
+		return HaltReason::STOPPED;
+	}
+
+	bool empty() const {
+		return this->positions.empty() && this->cells.empty();
+	}
+};
+
+/**
+ * Runs a machine under the control of commands read from std::cin, which
+ * set breakpoints, continue the run up to the next one, execute a few steps
+ * and show the tape and statistics whenever the run stops.
+ *
+ * Breakpoints on states and on states reading a symbol are transitions to
+ * HALT in a copy of the machine, and breakpoints on steps are step limits,
+ * so the run between them is as fast as any run without observers. Only
+ * breakpoints on cells look at every step.
+ */
+class Debugger {
+
+private:
+
+	enum BreakpointKind {
+		// the machine enters a state from another one
+		STATE,
+		// a state reads a symbol
+		RULE,
+		// the run reaches a number of steps
+		STEP,
+		// the head reaches a cell
+		POSITION,
+		// the symbol in a cell changes
+		CELL
+	};
+
+	struct Breakpoint {
+		BreakpointKind kind;
+		uint32_t state;
+		char symbol;
+		int64_t value;
+	};
+
+	const CompiledMachine& machine;
+	// a copy of the machine with HALT instead of every transition that a breakpoint stops
+	CompiledMachine stops;
+	RunOptions options;
+
+	std::vector<Breakpoint> breakpoints;
+	// the transitions set to HALT in the copy, which are restored when breakpoints change
+	std::vector<std::pair<uint32_t, char>> halts;
+	Watchpoints watch;
+
+	// how long the machine ran since the debugger started
+	std::chrono::duration<double> runTime{0};
+
+public:
+
+	/**
+	 * @param machine		The machine to debug, which has to outlive the debugger
+	 * @param options		Limits of the runs and how to show the tape; there is no timeout
+	 */
+	Debugger(const CompiledMachine& machine, const RunOptions& options);
+
+	/**
+	 * Run the machine on a tape, stopping before the first step and at every
+	 * breakpoint to read commands. Breakpoints stay set for the next run.
+	 *
+	 * @param tape		Pointer to the input tape
+	 *
+	 * @return why the machine stopped, along with statistics about the run;
+	 * 	STOPPED if the run was quit
+	 */
+	RunResult run(Tape* tape);
+
+private:
+
+	/**
+	 * Execute a command.
+	 *
+	 * @return false if the command ended the run
+	 */
+	bool execute(const std::string& command, Tape* tape, RunResult& current);
+
+	/**
+	 * Continue the run up to the next breakpoint, or for a number of steps
+	 * without stopping at any breakpoint.
+	 *
+	 * @param count		The number of steps, 0 to run up to the next breakpoint
+	 */
+	void proceed(Tape* tape, RunResult& current, uint64_t count);
+
+	/**
+	 * Continue the run on the original machine for a number of steps.
+	 *
+	 * @param watching	Stop at the breakpoints on cells
+	 *
+	 * @return false if the run ended or stopped at a cell before
+	 */
+	bool runOriginal(Tape* tape, RunResult& current, uint64_t steps, bool watching);
+
+	// the numbers of the first breakpoints of a kind that match, 0 if there is none
+	size_t ruleBreakpoint(uint32_t state, char symbol) const;
+	size_t stateBreakpoint(uint32_t state) const;
+	size_t stepBreakpoint(uint64_t step) const;
+	size_t cellBreakpoint() const;
+
+	// put HALT in the copy of the machine wherever a breakpoint stops it
+	void patch();
+
+	void announce(size_t number) const;
+	bool findState(const std::string& name, uint32_t& state) const;
+	void addBreakpoint(const std::vector<std::string>& words);
+	void listBreakpoints() const;
+	std::string describe(const Breakpoint& breakpoint) const;
+
+	void show(const Tape* tape, const RunResult& current, uint64_t radius) const;
+	void showStats(const Tape* tape, const RunResult& current) const;
+	void showHelp() const;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "TuringMachine.hpp"
+
+/**
+ * The kinds of lines in a .tm file.
+ */
+enum class LineKind {
+	// empty lines and comments
+	NOTHING,
+	RULE,
+	JUMP,
+	FINAL,
+	IMPORT,
+	ALPHABET,
+	TAPES
+};
+
+/**
+ * The parts of a single line of a .tm file.
+ * All names point into the parsed line.
+ */
+struct ParsedLine {
+	LineKind kind = LineKind::NOTHING;
+
+	// the states the rules start from; the final or imported state
+	std::vector<std::string_view> origins;
+	// the symbols the rules read; the tape alphabet
+	std::vector<char> symbols;
+	// for rules and jumps that write another symbol than they read
+	bool writes = false;
+	char writeSymbol = '\0';
+	Direction direction = Direction::STAND;
+	// for jumps: the symbol to stop at
+	char stopSymbol = '\0';
+	// for machines with several tapes: what the rules read, write and how they
+	// move on the tapes after the first, in the order of the tapes
+	std::vector<std::vector<char>> moreSymbols;
+	std::string moreWrites;
+	std::vector<Direction> moreDirections;
+	// the state the rules lead to; the state to continue in after an import
+	std::string_view target;
+
+	// for imports: the file and the state to start the imported machine at, if any
+	std::string_view file;
+	std::string_view importStart;
+
+	// for tape declarations: the number of tapes
+	unsigned tapes = 1;
+};
+
+/**
+ * A parser for the lines of .tm files.
+ *
+ * Every line is read in a single pass from left to right. The parts of the
+ * line are not copied, and the vectors of the result are reused from line to
+ * line, so parsing does not allocate any memory once they have grown.
+ * The grammar is documented in README.
+ */
+class LineParser {
+
+private:
+
+	// rules of machines with several tapes consist of tuples like "a|b"
+	unsigned tapes = 1;
+
+	std::string_view line;
+	size_t position = 0;
+
+	std::string error;
+	size_t errorPosition = 0;
+
+public:
+
+	/**
+	 * Parse a single line, without the line break.
+	 *
+	 * @param line		The line to parse
+	 * @param result	Where to store the parts of the line
+	 *
+	 * @return false if the line has a syntax error
+	 */
+	bool parse(std::string_view line, ParsedLine* result);
+
+	/**
+	 * Set the number of tapes the rules of the following lines refer to.
+	 */
+	void setTapes(unsigned tapes) {
+		this->tapes = tapes;
+	}
+
+	/**
+	 * Describe the last syntax error.
+	 */
+	const std::string& errorMessage() const {
+		return this->error;
+	}
+
+	/**
+	 * Get the column of the last syntax error, starting at 1.
+	 */
+	size_t errorColumn() const {
+		return this->errorPosition + 1;
+	}
+
+private:
+
+	bool fail(const std::string& message);
+	bool atEnd() const;
+	bool startsWith(std::string_view text) const;
+
+	bool expect(std::string_view text);
+	bool name(std::string_view* result);
+	bool symbol(char* result);
+	bool symbolClass(std::vector<char>* result);
+	bool readSymbols(std::vector<char>* result);
+	bool direction(Direction* result, bool stand);
+	bool end();
+
+	bool rule(ParsedLine* result);
+	bool import(ParsedLine* result);
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * A file that is mapped into memory read only.
+ *
+ * The pages of the file are only read from disk when they are accessed,
+ * and several processes using the same file share them.
+ */
+class MappedFile {
+
+private:
+
+	void* address = nullptr;
+	size_t length = 0;
+
+public:
+
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	/**
+	 * Map a file, replacing the file mapped before.
+	 *
+	 * @param filename	Path to the file
+	 *
+	 * @return false if the file could not be mapped
+	 */
+	bool open(const std::string& filename);
+
+	const char* data() const {
+		return static_cast<const char*>(this->address);
+	}
+
+	size_t size() const {
+		return this->length;
+	}
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TuringMachine.hpp"
+
+class Tape;
+
+/**
+ * A flattened form of a TuringMachine with several tapes.
+ *
+ * Every symbol a rule reads gets a dense index, and all other symbols share
+ * one more index, for which no rule exists. The tuple of symbols under the
+ * heads is a number with one such index per digit, so the table has one row
+ * per state and one column per tuple, and a step is a single lookup no matter
+ * how many rules a state has. What a transition writes and how it moves the
+ * heads is kept in separate arrays with one entry per tape.
+ */
+class MultiTapeMachine {
+
+	friend class TuringMachine;
+
+public:
+
+	// the target of table entries without a rule
+	static constexpr uint32_t HALT = UINT32_MAX;
+
+	// largest number of entries a table may have
+	static constexpr uint64_t MAX_ENTRIES = 1 << 24;
+
+private:
+
+	uint32_t tapes = 1;
+
+	// the dense index of every possible byte on the tapes
+	uint8_t symbolIndex[256] = {};
+	uint32_t symbols = 1;
+	// symbols ^ tapes
+	uint64_t columns = 1;
+
+	// one entry per state and tuple of symbols
+	std::vector<uint32_t> targets;
+	// tapes entries per entry of targets
+	std::vector<char> writes;
+	std::vector<uint8_t> directions;
+
+	std::vector<uint8_t> finalStates;
+	std::vector<std::string> names;
+	uint32_t start = 0;
+
+	// the entry of the table for a state and the symbols under the heads
+	inline size_t entry(uint32_t state, const std::vector<Tape*>& tapes) const;
+
+public:
+
+	uint32_t tapeCount() const {
+		return this->tapes;
+	}
+
+	uint32_t stateCount() const {
+		return this->finalStates.size();
+	}
+
+	uint32_t startState() const {
+		return this->start;
+	}
+
+	const std::string& stateName(uint32_t state) const {
+		return this->names[state];
+	}
+
+	bool isFinal(uint32_t state) const {
+		return this->finalStates[state] != 0;
+	}
+
+	/**
+	 * Run the machine on the given tapes, respecting the given limits.
+	 * The input is usually on the first tape and all others are empty.
+	 *
+	 * @param tapes		Pointers to tapeCount() tapes
+	 * @param options	Limits for the run and how to show the tapes;
+	 * 								maxTapeCells limits the cells of all tapes together
+	 *
+	 * @return why the machine stopped, along with statistics about the run
+	 */
+	RunResult run(const std::vector<Tape*>& tapes, const RunOptions& options) const;
+};
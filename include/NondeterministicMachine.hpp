@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CompiledMachine.hpp"
+#include "TuringMachine.hpp"
+
+/**
+ * Limits and settings for the search of an accepting branch.
+ */
+struct SearchOptions {
+	// maximum number of steps of a branch, 0 for no limit
+	uint64_t maxSteps = 0;
+	// maximum number of cells the tape of a branch may span, 0 for no limit
+	uint64_t maxTapeCells = 0;
+	// maximum number of configurations waiting to be explored, 0 for no limit
+	uint64_t maxFrontier = 0;
+	// maximum number of bytes the configurations may take, 0 for no limit
+	uint64_t maxMemory = 0;
+	// point in time after which the search is aborted
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+	// number of threads to explore a level on, 0 for all cores
+	unsigned threads = 1;
+};
+
+/**
+ * The outcome of a search; steps is the length of the accepting branch,
+ * or of the longest branch that was explored.
+ */
+struct SearchResult : RunResult {
+	// number of distinct configurations that were reached
+	uint64_t configurations = 0;
+	// number of times a configuration was reached again and dropped
+	uint64_t duplicates = 0;
+	// most configurations that waited to be explored at once
+	uint64_t peakFrontier = 0;
+	// the tape of the accepting branch
+	std::string tape;
+};
+
+/**
+ * A flattened form of a TuringMachine that may have several rules for the
+ * same state and symbol.
+ *
+ * Like CompiledMachine, states are numbered densely and jumps get a state
+ * that scans for the stop symbol, one cell per step. The choices of all
+ * states and symbols are kept in a single array, and a table with one entry
+ * per state and symbol tells where the choices of each of them start.
+ *
+ * search() explores all branches breadth first, level by level, so the
+ * shortest accepting branch is found first. The configurations of a level
+ * are spread over threads by a WorkStealingPool. Tapes are SharedTapes, so
+ * branches share the cells they did not write. Configurations that were
+ * reached before are found by their fingerprint and only dropped if their
+ * state, head and cells are the same, so the reached configurations are
+ * kept until the search ends.
+ */
+class NondeterministicMachine {
+
+	friend class TuringMachine;
+
+private:
+
+	// where the choices for state * SYMBOLS + symbol start, followed by the end of the last
+	std::vector<uint32_t> firstChoice;
+	std::vector<Transition> choices;
+	std::vector<uint8_t> finalStates;
+	std::vector<std::string> names;
+	uint32_t start = 0;
+
+public:
+
+	/**
+	 * Get the transitions the machine may choose from when reading a symbol in a state.
+	 *
+	 * @return the first choice and the end of the choices
+	 */
+	inline std::pair<const Transition*, const Transition*> lookup(uint32_t state, char symbol) const {
+		size_t index = state * CompiledMachine::SYMBOLS + static_cast<unsigned char>(symbol);
+		const Transition* all = this->choices.data();
+		return {all + this->firstChoice[index], all + this->firstChoice[index + 1]};
+	}
+
+	uint32_t stateCount() const {
+		return this->finalStates.size();
+	}
+
+	uint32_t startState() const {
+		return this->start;
+	}
+
+	const std::string& stateName(uint32_t state) const {
+		return this->names[state];
+	}
+
+	bool isFinal(uint32_t state) const {
+		return this->finalStates[state] != 0;
+	}
+
+	/**
+	 * Search for a branch that halts in a final state on the input.
+	 * The search stops as soon as one is found, once all branches halted
+	 * or once one of the limits is exceeded.
+	 *
+	 * @param input		Input to the machine
+	 * @param options	Limits for the search
+	 *
+	 * @return why the search stopped, along with statistics about it
+	 */
+	SearchResult search(const char* input, const SearchOptions& options) const;
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * The symbols that can be on a PackedTape, numbered densely.
+ * The empty symbol always gets the number 0.
+ */
+struct SymbolAlphabet {
+
+	static const char EMPTY_SYMBOL = '_';
+	static const unsigned MAX_SYMBOLS = 16;
+
+	char symbols[MAX_SYMBOLS];
+	// the number of every symbol, 0 for symbols that are not in the alphabet
+	uint8_t index[256];
+	unsigned count = 0;
+
+	/**
+	 * Number the symbols of a machine and its input.
+	 *
+	 * @param symbols	The symbols, in any order and with repetitions
+	 */
+	SymbolAlphabet(const std::string& symbols);
+
+	/**
+	 * Get the number of bits a cell needs to hold every symbol.
+	 *
+	 * @return 1, 2 or 4, or 0 if the alphabet has too many symbols for a PackedTape
+	 */
+	unsigned bitsPerCell() const;
+
+	bool contains(char symbol) const;
+};
+
+/**
+ * A tape that stores the number of the symbol of every cell in BITS bits,
+ * so tapes of machines with two symbols take an eighth of the memory of
+ * a Tape and much more of them fits into the caches.
+ *
+ * The cells are packed into 64 bit words, with the first cell in the lowest
+ * bits. Sweeps and scans compare whole words at once. Use the smallest BITS
+ * from SymbolAlphabet::bitsPerCell(); symbols that are not in the alphabet
+ * of the tape are written as the empty symbol.
+ */
+template<unsigned BITS>
+class PackedTape {
+
+	static_assert(BITS == 1 || BITS == 2 || BITS == 4, "Cells of a packed tape have 1, 2 or 4 bits");
+
+public:
+
+	static const char EMPTY_SYMBOL = SymbolAlphabet::EMPTY_SYMBOL;
+	static const unsigned CELLS_PER_WORD = 64 / BITS;
+	static const uint64_t CELL_MASK = (uint64_t(1) << BITS) - 1;
+	// the lowest bit of every cell in a word
+	static const uint64_t LOW_BITS = ~uint64_t(0) / CELL_MASK;
+
+private:
+
+	SymbolAlphabet alphabet;
+	std::vector<uint64_t> words;
+	uint64_t position;
+
+public:
+
+	/**
+	 * Construct the tape with the given input data as a string.
+	 *
+	 * @param input				Input to the Turing Machine
+	 * @param alphabet		The symbols of the machine and the input
+	 * @param startingPos	Position of the head within the input
+	 */
+	PackedTape(const char* input, const SymbolAlphabet& alphabet, uint64_t startingPos = 0);
+
+	/**
+	 * Output the data to a stream.
+	 *
+	 * @param stream		Stream to write to
+	 */
+	std::ostream& outputTape(std::ostream& stream) const;
+
+	/**
+	 * Append the cells around the head and a line marking the head to a
+	 * string, like Tape::render().
+	 *
+	 * @param out			The string to append to
+	 * @param radius	Number of cells to show on each side of the head, 0 for all
+	 */
+	void render(std::string& out, uint64_t radius) const;
+
+	// total number of cells on the tape
+	uint64_t size() const {
+		return this->words.size() * CELLS_PER_WORD;
+	}
+
+	// the memory taken by the cells
+	uint64_t bytes() const {
+		return this->words.size() * sizeof(uint64_t);
+	}
+
+	/**
+	 * Go one symbol to the sides and extend the tape if necessary.
+	 */
+	inline void stepLeft() {
+		if(this->position == 0)
+			this->growLeft();
+		this->position--;
+	}
+
+	inline void stepRight() {
+		if(this->position == this->size() - 1)
+			this->growRight();
+		this->position++;
+	}
+
+	/**
+	 * Move the head like Tape::scanLeft() and Tape::sweepLeft(),
+	 * looking at a whole word of cells at once.
+	 */
+	uint64_t scanLeft(char stop, uint64_t limit) {
+		uint64_t available = std::min<uint64_t>(this->position + 1, limit);
+		return this->moveLeft(this->findLeft(available, this->alphabet.index[static_cast<unsigned char>(stop)], true));
+	}
+
+	uint64_t scanRight(char stop, uint64_t limit) {
+		uint64_t available = std::min<uint64_t>(this->size() - this->position, limit);
+		return this->moveRight(this->findRight(available, this->alphabet.index[static_cast<unsigned char>(stop)], true));
+	}
+
+	uint64_t sweepLeft(uint64_t limit) {
+		uint64_t available = std::min<uint64_t>(this->position + 1, limit);
+		return this->moveLeft(this->findLeft(available, this->cell(this->position), false));
+	}
+
+	uint64_t sweepRight(uint64_t limit) {
+		uint64_t available = std::min<uint64_t>(this->size() - this->position, limit);
+		return this->moveRight(this->findRight(available, this->cell(this->position), false));
+	}
+
+	inline char getSymbol() const {
+		return this->alphabet.symbols[this->cell(this->position)];
+	}
+
+	inline void putSymbol(char symbol) {
+		uint64_t& word = this->words[this->position / CELLS_PER_WORD];
+		unsigned shift = (this->position % CELLS_PER_WORD) * BITS;
+		word = (word & ~(CELL_MASK << shift))
+			| (static_cast<uint64_t>(this->alphabet.index[static_cast<unsigned char>(symbol)]) << shift);
+	}
+
+private:
+
+	inline unsigned cell(uint64_t position) const {
+		return (this->words[position / CELLS_PER_WORD] >> ((position % CELLS_PER_WORD) * BITS)) & CELL_MASK;
+	}
+
+	// the lowest bit of every cell of a word that holds the symbol, or that does not
+	static inline uint64_t matches(uint64_t word, unsigned symbol, bool equal) {
+		uint64_t differ = word ^ (symbol * LOW_BITS);
+		for(unsigned shift = 1; shift < BITS; shift <<= 1)
+			differ |= differ >> shift;
+		differ &= LOW_BITS;
+		return equal ? differ ^ LOW_BITS : differ;
+	}
+
+	/**
+	 * Find the first cell from the head to one side that holds the symbol,
+	 * or that does not, among the next cells.
+	 *
+	 * @return the distance of the cell from the head, or cells if there is none
+	 */
+	uint64_t findRight(uint64_t cells, unsigned symbol, bool equal) const;
+	uint64_t findLeft(uint64_t cells, unsigned symbol, bool equal) const;
+
+	// move the head by cells, where the cells up to the new position are on the tape
+	// except maybe for the last one
+	inline uint64_t moveLeft(uint64_t cells) {
+		if(cells == 0)
+			return 0;
+		this->position -= cells - 1;
+		this->stepLeft();
+		return cells;
+	}
+
+	inline uint64_t moveRight(uint64_t cells) {
+		if(cells == 0)
+			return 0;
+		this->position += cells - 1;
+		this->stepRight();
+		return cells;
+	}
+
+	/**
+	 * Extend the tape at one end by at least its current length.
+	 */
+	void growLeft();
+	void growRight();
+};
+
+template<unsigned BITS>
+std::ostream& operator<<(std::ostream& stream, const PackedTape<BITS>& tape) {
+	return tape.outputTape(stream);
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CompiledMachine.hpp"
+#include "TuringMachine.hpp"
+
+class Tape;
+
+/**
+ * Counts how often each transition of a machine is used in a run, and
+ * where the head is after each step.
+ *
+ * The counters are a dense array parallel to the transition table of the
+ * machine, so counting a step is a single increment. Counts of states,
+ * rules and imported sub machines are derived from them in the report.
+ * A profiler watches a single run; profiles of several runs are merged.
+ */
+class Profiler {
+
+public:
+
+	static const bool EACH_STEP = true;
+
+private:
+
+	const CompiledMachine* machine;
+	// number of times each entry of the table was used
+	std::vector<uint64_t> counts;
+	uint64_t steps = 0;
+
+	// steps that ended on each position relative to the start of the head,
+	// positions from 0 to the right and from -1 to the left
+	std::vector<uint64_t> rightPositions, leftPositions;
+	int64_t head = 0;
+
+	// dense state ids by name, built when needed
+	mutable std::unordered_map<std::string, uint32_t> ids;
+	// how often each state was entered from another one, built when needed
+	mutable std::vector<uint64_t> entries;
+
+public:
+
+	/**
+	 * @param machine		The machine to profile, which has to outlive the profiler
+	 */
+	Profiler(const CompiledMachine& machine);
+
+	inline bool afterStep(const Tape*, uint32_t, char, const Transition& transition) {
+		// the transition is an entry of the table, its position is the counter
+		this->counts[&transition - &this->machine->lookup(0, 0)]++;
+		this->steps++;
+
+		if(transition.direction == Direction::LEFT)
+			this->head--;
+		else if(transition.direction == Direction::RIGHT)
+			this->head++;
+
+		std::vector<uint64_t>& positions = this->head >= 0 ? this->rightPositions : this->leftPositions;
+		size_t index = this->head >= 0 ? this->head : -this->head - 1;
+		if(index >= positions.size())
+			positions.resize(index + 1 + positions.size() / 2, 0);
+		positions[index]++;
+		return true;
+	}
+
+	HaltReason stopReason() const {
+		return HaltReason::HALTED;
+	}
+
+	/**
+	 * Begin to profile another run, whose head positions are counted from
+	 * where its own head starts. The counts of earlier runs are kept.
+	 */
+	void restart() {
+		this->head = 0;
+	}
+
+	/**
+	 * Add the counts of a profile of another run of the same machine.
+	 */
+	void merge(const Profiler& other);
+
+	uint64_t totalSteps() const {
+		return this->steps;
+	}
+
+	/**
+	 * Get how often the machine used the rule of a state for a symbol.
+	 */
+	uint64_t ruleCount(uint32_t state, char symbol) const {
+		if(state >= this->machine->stateCount())
+			return 0;
+		return this->counts[state * CompiledMachine::SYMBOLS + static_cast<unsigned char>(symbol)];
+	}
+
+	/**
+	 * Get the number of steps the machine made in a state, 0 for states it does not have.
+	 */
+	uint64_t stateSteps(uint32_t state) const;
+
+	/**
+	 * Get the number of steps the jumps of a state spent scanning for their
+	 * stop symbols. Jumps with the same direction, stop symbol and target
+	 * share a scan state, even jumps of different states, whose steps are
+	 * then split among the states by how often their jumps were taken.
+	 *
+	 * @return the steps, 0 for states without jumps
+	 */
+	uint64_t jumpSteps(uint32_t state) const;
+
+	/**
+	 * Find the dense id of a state of the machine by its name.
+	 *
+	 * @return the id, or stateCount() of the machine if there is no such state
+	 */
+	uint32_t stateId(const std::string& name) const;
+
+	/**
+	 * Write a human readable report: the busiest states and rules, the steps
+	 * spent in each imported sub machine and a histogram of head positions.
+	 *
+	 * @param out		The stream to write to
+	 * @param top		The number of states and rules to list
+	 */
+	void report(std::ostream& out, size_t top = 20) const;
+};
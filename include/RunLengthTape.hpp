@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <list>
+
+/**
+ * A run of equal symbols on a RunLengthTape.
+ */
+struct SymbolRun {
+	char symbol;
+	uint64_t length;
+};
+
+/**
+ * A tape that stores runs of equal symbols instead of single cells.
+ *
+ * Neighbouring runs always have different symbols. Machines working on
+ * unary numbers mostly consist of a few long runs, which makes this tape
+ * much smaller than a Tape, and allows the machine to cross a whole run
+ * in a single operation (see CompiledMachine::run).
+ */
+class RunLengthTape {
+
+public:
+
+	static const char EMPTY_SYMBOL = '_';
+
+private:
+
+	std::list<SymbolRun> runs;
+
+	// the run the head is in, and the position of the head within it
+	std::list<SymbolRun>::iterator current;
+	uint64_t offset;
+
+	// total number of cells in all runs
+	uint64_t cells;
+
+public:
+
+	/**
+	 * Construct the tape with the given input data as a string.
+	 *
+	 * @param input				Input to the Turing Machine
+	 * @param startingPos	Position of the head within the input
+	 */
+	RunLengthTape(const char* input, uint64_t startingPos = 0);
+
+	RunLengthTape(const RunLengthTape& other);
+
+	/**
+	 * Output the data to a stream, expanding all runs.
+	 *
+	 * @param stream		Stream to write to
+	 */
+	std::ostream& outputTape(std::ostream& stream) const;
+
+	/**
+	 * Append the cells around the head and a line marking the head to a
+	 * string, like Tape::render(). Only the runs close to the head are expanded.
+	 *
+	 * @param out			The string to append to
+	 * @param radius	Number of cells to show on each side of the head, 0 for all
+	 */
+	void render(std::string& out, uint64_t radius) const;
+
+	/**
+	 * Go one symbol to the sides and extend the tape if necessary.
+	 */
+	void stepLeft();
+	void stepRight();
+
+	/**
+	 * Move the head by several cells within the current run.
+	 * Moving to the end of the run puts the head onto the first cell of the
+	 * neighbouring run.
+	 *
+	 * @param count		Number of cells to move, at most remainingLeft()
+	 * 								or remainingRight() respectively
+	 */
+	void skipLeft(uint64_t count);
+	void skipRight(uint64_t count);
+
+	/**
+	 * Get the number of cells of the current run from the head to the end
+	 * of the run in either direction, including the cell under the head.
+	 */
+	inline uint64_t remainingLeft() const {
+		return this->offset + 1;
+	}
+
+	inline uint64_t remainingRight() const {
+		return this->current->length - this->offset;
+	}
+
+	inline char getSymbol() const {
+		return this->current->symbol;
+	}
+
+	/**
+	 * Set the current symbol, splitting and merging runs as necessary.
+	 */
+	void putSymbol(char symbol);
+
+	/**
+	 * Get the number of cells on the tape.
+	 */
+	uint64_t size() const {
+		return this->cells;
+	}
+
+	/**
+	 * Get the number of runs the tape consists of.
+	 */
+	size_t runCount() const {
+		return this->runs.size();
+	}
+
+private:
+
+	/**
+	 * Merge the run with its neighbours if they carry the same symbol.
+	 * The head stays on the same cell.
+	 */
+	void mergeCurrent();
+};
+
+std::ostream& operator<<(std::ostream& stream, const RunLengthTape& tape);
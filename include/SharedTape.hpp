@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A tape that is cheap to copy, for searches that keep many configurations.
+ *
+ * The cells are kept in small chunks that copies of a tape share until one
+ * of them writes to a chunk, which then gets a chunk of its own. Cells that
+ * were never written share a single blank chunk. Copying a tape copies
+ * pointers to the chunks instead of the cells.
+ *
+ * The tape keeps two polynomial hashes of its content and head position
+ * up to date with every write and move, so configurations can be found by
+ * their fingerprint without looking at the cells. Different tapes may have
+ * the same fingerprint, so only sameAfter() tells whether they are equal.
+ */
+class SharedTape {
+
+public:
+
+	static const char EMPTY_SYMBOL = '_';
+	static const uint32_t CHUNK_CELLS = 64;
+
+	// two 64 bit hashes of the content and the head position
+	struct Fingerprint {
+		uint64_t first;
+		uint64_t second;
+
+		bool operator==(const Fingerprint& other) const {
+			return this->first == other.first && this->second == other.second;
+		}
+	};
+
+private:
+
+	struct Chunk {
+		char cells[CHUNK_CELLS];
+	};
+
+	std::vector<std::shared_ptr<Chunk>> chunks;
+	// position of the first cell of the first chunk, relative to the first input cell
+	int64_t first = 0;
+	// position of the head, relative to the first input cell
+	int64_t head = 0;
+
+	// hashes of the content and the powers of their bases at the head position
+	uint64_t hashes[2] = {0, 0};
+	uint64_t powers[2] = {1, 1};
+
+	// counts the chunks that were allocated and not freed yet, may be nullptr
+	std::atomic<int64_t>* allocated = nullptr;
+
+public:
+
+	/**
+	 * Construct the tape with the head on the first symbol of the input.
+	 *
+	 * @param input			Input to the Turing Machine
+	 * @param allocated	If not nullptr, keeps track of the chunks this tape
+	 * 									and its copies allocate
+	 */
+	SharedTape(const char* input, std::atomic<int64_t>* allocated = nullptr);
+
+	inline char getSymbol() const {
+		int64_t cell = this->head - this->first;
+		return this->chunks[cell / CHUNK_CELLS]->cells[cell % CHUNK_CELLS];
+	}
+
+	/**
+	 * Write a symbol under the head, copying its chunk first if it is shared.
+	 */
+	void putSymbol(char symbol);
+
+	/**
+	 * Move the head by one cell, extending the tape by a blank chunk if necessary.
+	 */
+	void stepLeft();
+	void stepRight();
+
+	/**
+	 * Get the number of cells the tape spans.
+	 */
+	uint64_t size() const {
+		return this->chunks.size() * CHUNK_CELLS;
+	}
+
+	/**
+	 * Get the number of chunks, shared or not, the tape points to.
+	 */
+	size_t chunkCount() const {
+		return this->chunks.size();
+	}
+
+	/**
+	 * Get the fingerprint of the content and the head position. Tapes that
+	 * only differ in blank cells at their ends have the same fingerprint.
+	 */
+	Fingerprint fingerprint() const;
+
+	/**
+	 * Get the fingerprint the tape would have after writing a symbol and
+	 * moving the head, without changing the tape.
+	 *
+	 * @param symbol	The symbol to write
+	 * @param move		-1 to move left, 1 to move right, 0 to stand
+	 */
+	Fingerprint fingerprintAfter(char symbol, int move) const;
+
+	/**
+	 * Tell whether another tape holds the cells and head position this tape
+	 * would have after writing a symbol and moving the head. Both tapes have
+	 * to start from the same input; chunks they share are not compared.
+	 *
+	 * @param other		The tape to compare with
+	 * @param symbol	The symbol to write
+	 * @param move		-1 to move left, 1 to move right, 0 to stand
+	 */
+	bool sameAfter(const SharedTape& other, char symbol, int move) const;
+
+	/**
+	 * Output the cells that were visited and a line marking the head.
+	 */
+	std::ostream& outputTape(std::ostream& stream) const;
+
+private:
+
+	std::shared_ptr<Chunk> newChunk(const Chunk& content) const;
+
+	// the chunk that starts at a position, the blank chunk outside of the tape
+	const Chunk* chunkAt(int64_t position) const;
+
+	// the chunk all cells that were never written point to
+	static const std::shared_ptr<Chunk>& blankChunk();
+};
+
+std::ostream& operator<<(std::ostream& stream, const SharedTape& tape);
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#include "CompiledMachine.hpp"
+#include "Tape.hpp"
+#include "TuringMachine.hpp"
+
+/**
+ * A rule of a machine that is known at compile time.
+ * States are referred to by name, just like in .tm files.
+ */
+struct StaticRule {
+	const char* origin;
+	char readSymbol;
+	char writeSymbol;
+	Direction direction;
+	const char* target;
+};
+
+/*
+ * Compile time helpers for StaticMachine.
+ */
+namespace static_machine {
+
+constexpr bool sameName(const char* a, const char* b) {
+	while(*a != '\0' && *a == *b) {
+		a++;
+		b++;
+	}
+	return *a == *b;
+}
+
+// all state names in the order rules and final states mention them, with repetitions
+template<size_t R, size_t F>
+constexpr const char* mentionedName(const StaticRule (&rules)[R], const char* const (&finals)[F], size_t i) {
+	if(i < R)
+		return rules[i].origin;
+	if(i < 2 * R)
+		return rules[i - R].target;
+	return finals[i - 2 * R];
+}
+
+template<size_t R, size_t F>
+constexpr bool firstMention(const StaticRule (&rules)[R], const char* const (&finals)[F], size_t i) {
+	for(size_t j = 0; j < i; j++) {
+		if(sameName(mentionedName(rules, finals, j), mentionedName(rules, finals, i)))
+			return false;
+	}
+	return true;
+}
+
+template<size_t R, size_t F>
+constexpr size_t countStates(const StaticRule (&rules)[R], const char* const (&finals)[F]) {
+	size_t count = 0;
+	for(size_t i = 0; i < 2 * R + F; i++) {
+		if(firstMention(rules, finals, i))
+			count++;
+	}
+	return count;
+}
+
+// the dense id of a state: states are numbered in the order they are mentioned first
+template<size_t R, size_t F>
+constexpr uint32_t stateId(const StaticRule (&rules)[R], const char* const (&finals)[F], const char* name) {
+	uint32_t id = 0;
+	for(size_t i = 0; i < 2 * R + F; i++) {
+		if(!firstMention(rules, finals, i))
+			continue;
+		if(sameName(mentionedName(rules, finals, i), name))
+			return id;
+		id++;
+	}
+	return id;
+}
+
+template<size_t R>
+constexpr bool isDeterministic(const StaticRule (&rules)[R]) {
+	for(size_t i = 0; i < R; i++) {
+		for(size_t j = i + 1; j < R; j++) {
+			if(rules[i].readSymbol == rules[j].readSymbol && sameName(rules[i].origin, rules[j].origin))
+				return false;
+		}
+	}
+	return true;
+}
+
+// every target needs rules of its own or has to be a final state
+template<size_t R, size_t F>
+constexpr bool targetsExist(const StaticRule (&rules)[R], const char* const (&finals)[F]) {
+	for(size_t i = 0; i < R; i++) {
+		bool found = false;
+		for(size_t j = 0; j < R && !found; j++)
+			found = sameName(rules[i].target, rules[j].origin);
+		for(size_t j = 0; j < F && !found; j++)
+			found = sameName(rules[i].target, finals[j]);
+		if(!found)
+			return false;
+	}
+	return true;
+}
+
+// final states that no rule leads to and that have no rules are most likely typos
+template<size_t R, size_t F>
+constexpr bool finalStatesUsed(const StaticRule (&rules)[R], const char* const (&finals)[F]) {
+	for(size_t i = 0; i < F; i++) {
+		bool found = false;
+		for(size_t j = 0; j < R && !found; j++)
+			found = sameName(finals[i], rules[j].origin) || sameName(finals[i], rules[j].target);
+		if(!found)
+			return false;
+	}
+	return true;
+}
+
+template<size_t S, size_t R, size_t F>
+constexpr std::array<Transition, S * CompiledMachine::SYMBOLS>
+buildTable(const StaticRule (&rules)[R], const char* const (&finals)[F]) {
+	std::array<Transition, S * CompiledMachine::SYMBOLS> table{};
+	for(size_t i = 0; i < R; i++) {
+		uint32_t origin = stateId(rules, finals, rules[i].origin);
+		uint32_t target = stateId(rules, finals, rules[i].target);
+		bool sweep = origin == target && rules[i].readSymbol == rules[i].writeSymbol
+			&& rules[i].direction != Direction::STAND;
+
+		table[origin * CompiledMachine::SYMBOLS + static_cast<unsigned char>(rules[i].readSymbol)] = {
+			target, rules[i].writeSymbol, static_cast<uint8_t>(rules[i].direction),
+			sweep ? TransitionKind::SWEEP : TransitionKind::MOVE, 0
+		};
+	}
+	return table;
+}
+
+template<size_t S, size_t R, size_t F>
+constexpr std::array<bool, S> buildFinalStates(const StaticRule (&rules)[R], const char* const (&finals)[F]) {
+	std::array<bool, S> result{};
+	for(size_t i = 0; i < F; i++)
+		result[stateId(rules, finals, finals[i])] = true;
+	return result;
+}
+
+} // namespace static_machine
+
+/**
+ * A Turing Machine that is completely known at compile time.
+ *
+ * The rules and the final states are constexpr arrays, and the first rule
+ * determines the start state, just like in .tm files. The machine is checked
+ * for determinism and for rules that lead nowhere while compiling, and its
+ * transition table is a constant, so there is no setup at run time and no
+ * memory is allocated for the machine.
+ *
+ * Example:
+ * 	constexpr StaticRule rules[] = {
+ * 		{"S", '0', '1', Direction::RIGHT, "S"},
+ * 		{"S", '_', '_', Direction::STAND, "F"},
+ * 	};
+ * 	constexpr const char* finals[] = {"F"};
+ * 	using Machine = StaticMachine<rules, finals>;
+ * 	bool accepted = Machine::run(&tape).accepted;
+ */
+template<const auto& Rules, const auto& FinalStates>
+class StaticMachine {
+
+public:
+
+	static constexpr size_t STATES = static_machine::countStates(Rules, FinalStates);
+
+	static_assert(std::size(Rules) > 0, "A static machine needs at least one rule");
+	static_assert(static_machine::isDeterministic(Rules),
+		"A state of the static machine has more than one rule for the same symbol");
+	static_assert(static_machine::targetsExist(Rules, FinalStates),
+		"A rule of the static machine leads to a state that has no rules and is not final");
+	static_assert(static_machine::finalStatesUsed(Rules, FinalStates),
+		"A final state of the static machine is not used by any rule");
+
+private:
+
+	static constexpr std::array<Transition, STATES * CompiledMachine::SYMBOLS> table
+		= static_machine::buildTable<STATES>(Rules, FinalStates);
+	static constexpr std::array<bool, STATES> finalStates
+		= static_machine::buildFinalStates<STATES>(Rules, FinalStates);
+
+public:
+
+	/**
+	 * Get the dense id of a state, which can be used as a constant expression.
+	 */
+	static constexpr uint32_t stateId(const char* name) {
+		return static_machine::stateId(Rules, FinalStates, name);
+	}
+
+	/**
+	 * Run the machine on a given input, respecting the given limits.
+	 *
+	 * @param tape		Pointer to the input tape
+	 * @param options	Limits for the run; the tape is never shown
+	 *
+	 * @return why the machine stopped, along with statistics about the run
+	 */
+	static RunResult run(Tape* tape, const RunOptions& options = RunOptions()) {
+		auto startTime = std::chrono::steady_clock::now();
+		bool checkDeadline = options.deadline != std::chrono::steady_clock::time_point::max();
+
+		RunResult result;
+		uint32_t currentState = 0;
+
+		while(true) {
+			// execute a block of steps without looking at the limits
+			uint64_t block = 4096;
+			if(options.maxSteps != 0) {
+				if(result.steps >= options.maxSteps) {
+					result.reason = HaltReason::STEP_LIMIT;
+					break;
+				}
+				if(options.maxSteps - result.steps < block)
+					block = options.maxSteps - result.steps;
+			}
+
+			uint64_t done = 0;
+			bool halted = false;
+			while(done < block) {
+				const Transition& transition = table[currentState * CompiledMachine::SYMBOLS
+					+ static_cast<unsigned char>(tape->getSymbol())];
+
+				if(transition.kind == TransitionKind::HALT) {
+					halted = true;
+					break;
+				} else if(transition.kind == TransitionKind::SWEEP) {
+					if(transition.direction == Direction::LEFT)
+						done += tape->sweepLeft(block - done);
+					else
+						done += tape->sweepRight(block - done);
+					continue;
+				}
+
+				tape->putSymbol(transition.writeSymbol);
+				if(transition.direction == Direction::LEFT)
+					tape->stepLeft();
+				else if(transition.direction == Direction::RIGHT)
+					tape->stepRight();
+
+				currentState = transition.target;
+				done++;
+			}
+			result.steps += done;
+
+			if(halted)
+				break;
+
+			if(options.maxTapeCells != 0 && tape->length > options.maxTapeCells) {
+				result.reason = HaltReason::TAPE_LIMIT;
+				break;
+			}
+
+			if(checkDeadline && std::chrono::steady_clock::now() >= options.deadline) {
+				result.reason = HaltReason::TIMEOUT;
+				break;
+			}
+		}
+
+		result.accepted = result.reason == HaltReason::HALTED && finalStates[currentState];
+		result.peakTapeSize = tape->length;
+		result.elapsed = std::chrono::steady_clock::now() - startTime;
+
+		return result;
+	}
+};
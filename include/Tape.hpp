@@ -1,4 +1,8 @@
+#pragma once
+
+#include <cstdint>
 #include <iostream>
+#include <string>
 
 class Tape {
 	
@@ -15,6 +19,16 @@ public:
 	// current index on the tape
 	uint32_t currentPos;
 
+	// index of the first cell of the input, which moves along when the tape grows to the left
+	uint32_t origin;
+
+private:
+
+	// size of the memory mapping the data lives in, 0 if it was allocated with new
+	size_t mapping = 0;
+	// bytes of the mapping in front of the data, when the data does not start at a page
+	size_t mappingOffset = 0;
+
 public:
 	/**
 	 * Construct the tape with the given input data as a string.
@@ -37,6 +51,46 @@ public:
 	Tape(const Tape& other);
 	
 	~Tape();
+
+	/**
+	 * Replace the contents of the tape by the word in a file, with the head
+	 * on its first symbol. A line break at the end of the file is not part
+	 * of the word.
+	 * The file is mapped copy on write instead of read, so only the cells
+	 * the machine visits are loaded from disk and the word is never copied;
+	 * only a page of empty cells on each side of it is allocated.
+	 *
+	 * @param filename	Path to the file
+	 *
+	 * @return false if the file could not be mapped
+	 */
+	bool load(const std::string& filename);
+
+	/**
+	 * Replace the contents of the tape by cells stored in a part of a file,
+	 * like the tape of a checkpoint. The cells are mapped copy on write just
+	 * like by load(), so they are neither read nor copied up front and the
+	 * file never changes, but no empty cells are added around them.
+	 *
+	 * @param filename	Path to the file
+	 * @param offset		Position of the first cell in the file
+	 * @param length		Number of cells
+	 * @param head			Index of the cell the head is on
+	 * @param origin		Index of the first cell of the input
+	 *
+	 * @return false if the file could not be mapped
+	 */
+	bool map(const std::string& filename, uint64_t offset, uint32_t length, uint32_t head, uint32_t origin);
+
+	/**
+	 * Write the cells between the first and the last one that is not empty
+	 * into a file, without a line break, so it can be loaded again.
+	 *
+	 * @param filename	Path to the file
+	 *
+	 * @return false if the file could not be written
+	 */
+	bool save(const std::string& filename) const;
 	
 	/**
 	 * Output the data to a stream.
@@ -44,6 +98,16 @@ public:
 	 * @param stream		Stream to write to
 	 */
 	std::ostream& outputTape(std::ostream& stream) const;
+
+	/**
+	 * Append the cells around the head and a line marking the head to a
+	 * string, without a line break at the end. Hidden cells are counted
+	 * in markers like "<120 " and " 80>".
+	 *
+	 * @param out			The string to append to
+	 * @param radius	Number of cells to show on each side of the head, 0 for all
+	 */
+	void render(std::string& out, uint64_t radius) const;
 	
 	/*
 	 *  --- functions to interact with the data --- 
@@ -53,15 +117,49 @@ public:
 	 * Go one symbol to the sides and extend the tape if necessary.
 	 * This moves the head and not the tape.
 	 */
-	void stepLeft();
-	void stepRight();
+	inline void stepLeft() {
+		if(this->currentPos == 0)
+			this->growLeft();
+		this->currentPos--;
+	}
+
+	inline void stepRight() {
+		if(this->currentPos == this->length - 1)
+			this->growRight();
+		this->currentPos++;
+	}
 	
+	/**
+	 * Move the head to one side until it stands on the stop symbol,
+	 * but by at most limit cells. The tape is extended as necessary.
+	 *
+	 * @param stop		The symbol to search for
+	 * @param limit		The maximum number of cells to move
+	 *
+	 * @return the number of cells the head moved
+	 */
+	uint64_t scanLeft(char stop, uint64_t limit);
+	uint64_t scanRight(char stop, uint64_t limit);
+
+	/**
+	 * Move the head to one side for as long as it reads the symbol it reads
+	 * now, but by at most limit cells. The tape is extended as necessary.
+	 *
+	 * @param limit		The maximum number of cells to move
+	 *
+	 * @return the number of cells the head moved
+	 */
+	uint64_t sweepLeft(uint64_t limit);
+	uint64_t sweepRight(uint64_t limit);
+
 	/**
 	 * Get the current symbol.
 	 * 
 	 * @return Character at the current position.
 	 */
-	char getSymbol();
+	inline char getSymbol() const {
+		return this->data[this->currentPos];
+	}
 	
 	/**
 	 * Set the current symbol.
@@ -69,7 +167,9 @@ public:
 	 * 
 	 * @param symbol Character to put at the current position.
 	 */
-	void putSymbol(char symbol);
+	inline void putSymbol(char symbol) {
+		this->data[this->currentPos] = symbol;
+	}
 	
 	/**
 	 * Put the empty symbol onto the tape.
@@ -78,6 +178,21 @@ public:
 	inline void putSymbol() {
 		putSymbol(Tape::EMPTY_SYMBOL);
 	}
+
+private:
+
+	/**
+	 * Extend the data at one end. The tape grows by at least its current
+	 * length, so walking off an edge repeatedly costs amortized constant
+	 * time per new cell.
+	 */
+	void growLeft();
+	void growRight();
+
+	/**
+	 * Free the data, however it was allocated.
+	 */
+	void release();
 };
 
 std::ostream& operator<<(std::ostream& stream, const Tape& tape);
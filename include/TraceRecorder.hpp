@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CompiledMachine.hpp"
+#include "MappedFile.hpp"
+#include "TuringMachine.hpp"
+
+class Tape;
+
+/*
+ * Layout of trace files: the header, the offsets of the state names and the
+ * names like in compiled machines, the tape the run started on and then one
+ * TraceStep for every step. All numbers are stored in the byte order of the
+ * machine that wrote them.
+ */
+struct TraceHeader {
+	char magic[4];
+	uint32_t version;
+	// tells apart files from machines with another byte order
+	uint32_t byteOrder;
+	uint32_t states;
+	uint32_t start;
+	// the position of the head on the starting tape
+	uint32_t head;
+	uint64_t nameBytes;
+	uint64_t tapeBytes;
+};
+
+/**
+ * What a single step did: the state it went to, the symbol it wrote and
+ * where it moved. Steps are stored in 6 bytes each.
+ */
+struct TraceStep {
+	static const size_t BYTES = 6;
+
+	uint32_t state;
+	char writeSymbol;
+	// a Direction
+	uint8_t direction;
+
+	void store(char* bytes) const {
+		memcpy(bytes, &this->state, sizeof(this->state));
+		bytes[4] = this->writeSymbol;
+		bytes[5] = static_cast<char>(this->direction);
+	}
+
+	static TraceStep load(const char* bytes) {
+		TraceStep step;
+		memcpy(&step.state, bytes, sizeof(step.state));
+		step.writeSymbol = bytes[4];
+		step.direction = static_cast<uint8_t>(bytes[5]);
+		return step;
+	}
+};
+
+/**
+ * Records every step of a run into a binary trace file.
+ *
+ * Steps are collected in a buffer and written in large blocks, so a run
+ * that is traced is only a few times slower than one that is not.
+ * The trace is complete once the recorder is destroyed. If the file cannot
+ * be written, e.g. because the disk is full, this is reported and the run
+ * goes on without recording the rest of it.
+ */
+class TraceRecorder {
+
+public:
+
+	static const bool EACH_STEP = true;
+
+private:
+
+	std::string filename;
+	std::ofstream file;
+	std::vector<char> buffer;
+	size_t used = 0;
+	// set once a write failed, after which the steps are dropped
+	bool failed = false;
+
+	void flush();
+
+	/**
+	 * Report a failed write once and stop recording.
+	 */
+	void fail();
+
+public:
+
+	TraceRecorder() = default;
+	TraceRecorder(TraceRecorder&&) = default;
+	~TraceRecorder();
+
+	/**
+	 * Start a trace file for a run.
+	 *
+	 * @param filename	The file to write to
+	 * @param machine		The machine that is run
+	 * @param tape			The tape the run starts on
+	 *
+	 * @return false if the file could not be written
+	 */
+	bool open(const std::string& filename, const CompiledMachine& machine, const Tape* tape);
+
+	inline bool afterStep(const Tape*, uint32_t state, char, const Transition& transition) {
+		if(this->used + TraceStep::BYTES > this->buffer.size())
+			this->flush();
+
+		TraceStep step = {state, transition.writeSymbol, transition.direction};
+		step.store(this->buffer.data() + this->used);
+		this->used += TraceStep::BYTES;
+		return true;
+	}
+
+	HaltReason stopReason() const {
+		return HaltReason::HALTED;
+	}
+};
+
+/**
+ * A trace file written by TraceRecorder, mapped into memory.
+ */
+class Trace {
+
+private:
+
+	MappedFile file;
+	TraceHeader header = {};
+	const uint32_t* nameOffsets = nullptr;
+	const char* names = nullptr;
+	const char* tape = nullptr;
+	const char* steps = nullptr;
+	uint64_t count = 0;
+
+public:
+
+	/**
+	 * Open a trace file.
+	 *
+	 * @param filename	The file to read
+	 *
+	 * @return false if the file could not be read or is no trace
+	 */
+	bool open(const std::string& filename);
+
+	uint64_t stepCount() const {
+		return this->count;
+	}
+
+	TraceStep step(uint64_t index) const {
+		return TraceStep::load(this->steps + index * TraceStep::BYTES);
+	}
+
+	uint32_t stateCount() const {
+		return this->header.states;
+	}
+
+	uint32_t startState() const {
+		return this->header.start;
+	}
+
+	std::string_view stateName(uint32_t state) const {
+		return std::string_view(this->names + this->nameOffsets[state],
+														this->nameOffsets[state + 1] - this->nameOffsets[state]);
+	}
+
+	/**
+	 * The cells of the tape the run started on.
+	 */
+	std::string_view startTape() const {
+		return std::string_view(this->tape, this->header.tapeBytes);
+	}
+
+	uint32_t startHead() const {
+		return this->header.head;
+	}
+};
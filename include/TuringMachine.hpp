@@ -1,20 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
 
 class Tape;
+class CompiledMachine;
 
 enum Direction {
 	LEFT = 0, RIGHT, STAND
 };
 
+enum RuleKind {
+	// write, move by one cell and change the state
+	SINGLE = 0,
+	// write, then keep moving until the stop symbol is next and change the state
+	JUMP
+};
+
 struct Rule;
+class MultiTapeMachine;
+class NondeterministicMachine;
+class Checkpoint;
+class Profiler;
+class Watchpoints;
+struct RunResult;
 
 struct State {
 	std::string name;
 	std::vector<Rule> rules;
 	bool finalState = false;
-  bool auxiliaryState = false;
 };
 
 struct Rule {
@@ -22,6 +40,113 @@ struct Rule {
 	char writeSymbol;
 	Direction direction;
 	State*	target;
+	RuleKind kind = RuleKind::SINGLE;
+	// for jumps: the symbol in front of which the head stops
+	char stopSymbol = '\0';
+	// for machines with several tapes: what the rule reads, writes and how it
+	// moves on the tapes after the first, in the order of the tapes
+	std::string moreReads, moreWrites;
+	std::vector<Direction> moreDirections;
+};
+
+/**
+ * The reason why a run of a machine stopped.
+ */
+enum HaltReason {
+	// no rule applies to the current state and symbol
+	HALTED = 0,
+	// the run was aborted because it exceeded one of its RunOptions
+	STEP_LIMIT, TAPE_LIMIT, TIMEOUT,
+	// the machine could not be compiled and was not run at all
+	INVALID_MACHINE,
+	// the machine was proven to run forever
+	CYCLE,
+	// the search of a nondeterministic machine exceeded one of its SearchOptions
+	FRONTIER_LIMIT, MEMORY_LIMIT,
+	// the run reached a breakpoint or was stopped in the Debugger
+	STOPPED
+};
+
+/**
+ * Limits and settings for a single run of a machine.
+ * Limits are checked every few thousand steps, so a run may exceed
+ * the tape and time limits by the work of one such block.
+ */
+struct RunOptions {
+	// maximum number of steps, 0 for no limit
+	uint64_t maxSteps = 0;
+	// maximum number of cells the tape may allocate, 0 for no limit
+	uint64_t maxTapeCells = 0;
+	// point in time after which the run is aborted
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+	// show the tape after each step
+	bool showDebug = false;
+	// number of cells to show on each side of the head, 0 for the whole tape
+	uint64_t debugWindow = 0;
+	// show the tape only every this many steps
+	uint64_t debugInterval = 1;
+	// show at most this many frames per second, 0 for no limit
+	double debugFrameRate = 0;
+	// stop as soon as the machine is proven to run forever; needs a Tape
+	bool detectCycles = false;
+	// if not empty, record every step into this file; needs a Tape and is not done for resumed runs
+	std::string traceFile;
+	// if set, count the steps of the run into this profile; needs a Tape
+	Profiler* profile = nullptr;
+	// if not empty, save the configuration into this file every checkpointInterval seconds; needs a Tape
+	std::string checkpointFile;
+	double checkpointInterval = 60;
+	// if set, continue the run saved in this checkpoint on a tape made from it
+	const Checkpoint* resume = nullptr;
+	// if set, continue the run that stopped with this result, on the tape it stopped with
+	const RunResult* proceed = nullptr;
+	// if set, stop the run when the head reaches or writes one of these cells; needs a Tape
+	Watchpoints* watch = nullptr;
+};
+
+/**
+ * The outcome of a run and some statistics about it.
+ */
+struct RunResult {
+	HaltReason reason = HaltReason::HALTED;
+	// true if the machine halted in a final state
+	bool accepted = false;
+	uint64_t steps = 0;
+	// number of cells allocated by the tape at the end of the run
+	uint64_t peakTapeSize = 0;
+	// dense id of the state the run stopped in, as in CompiledMachine
+	uint32_t state = 0;
+	std::chrono::duration<double> elapsed{0};
+};
+
+/**
+ * What TuringMachine::graph_to_file() shows of a machine.
+ */
+struct GraphOptions {
+	// if set, label and colour states and rules by the steps of this profile
+	const Profiler* profile = nullptr;
+	// draw the states of every imported machine inside a box
+	bool clusters = false;
+	// draw every imported machine as a single node, without its insides
+	bool collapseImports = false;
+	// the number of states to show, 0 for all: the busiest ones with a profile,
+	// the nearest to the start state otherwise
+	size_t maxStates = 0;
+};
+
+/**
+ * How much TuringMachine::minimize() reduced a machine.
+ */
+struct MinimizeResult {
+	size_t statesBefore = 0;
+	// states the start state can not reach
+	size_t unreachable = 0;
+	// states that behave exactly like another state and were merged into it
+	size_t merged = 0;
+
+	size_t statesAfter() const {
+		return this->statesBefore - this->unreachable - this->merged;
+	}
 };
 
 class TuringMachine {
@@ -32,6 +157,65 @@ private:
 	std::map<std::string, State> states;
 	std::string start;
 	std::vector<char> tapeAlphabet;
+	unsigned tapes = 1;
+
+	// cached result of compile(), dropped whenever the machine is modified
+	std::shared_ptr<const CompiledMachine> compiled;
+
+	/**
+	 * Get the compiled form of the machine, compiling it if necessary.
+	 *
+	 * @return the compiled machine or nullptr if the machine could not be compiled
+	 */
+	const CompiledMachine* getCompiled();
+
+	/**
+	 * Find the states the start state can reach, with a breadth first search.
+	 *
+	 * @return the states in the order they were found, the start state first
+	 */
+	std::vector<State*> reachableStates();
+
+	/**
+	 * Read a machine file and resolve its imports, without any prefix.
+	 * Every file is only read once while create_from_file() runs, as long
+	 * as it does not change, and imported files that are not known yet are
+	 * read in parallel. Circular imports are found even when the files of
+	 * the circle are read on different threads.
+	 *
+	 * @param filename	The file from which to read the machine
+	 * @param importing	The files that import this one, to find circular imports
+	 *
+	 * @return the machine, shared with all other imports of the same file,
+	 * 				or nullptr if the file imports itself, directly or through other files
+	 */
+	static std::shared_ptr<const TuringMachine> load_file(const std::string& filename,
+																												const std::vector<std::string>& importing);
+
+	/**
+	 * Read a single machine file; see load_file().
+	 *
+	 * @param filename	The file from which to read the machine
+	 * @param importing	The files that import this one, including this one
+	 */
+	static std::shared_ptr<const TuringMachine> parse_file(const std::string& filename,
+																												const std::vector<std::string>& importing);
+
+	/**
+	 * Copy the states and rules of another machine into this one,
+	 * renaming the states on the way.
+	 *
+	 * @param other		The machine to copy
+	 * @param prefix	Prepended to the names of the copied states
+	 * @param entry		A state of the other machine that is renamed to alias instead, may be empty
+	 * @param alias		The new name of the entry state
+	 * @param exit		If not empty, the final states are not copied and their
+	 * 								rules lead to this state instead; otherwise the other
+	 * 								machine is copied as it is
+	 */
+	void insertMachine(const TuringMachine& other, const std::string& prefix,
+										const std::string& entry = "", const std::string& alias = "",
+										const std::string& exit = "");
 
 public:
 	
@@ -40,6 +224,10 @@ public:
 	/**
 	 * Construct a new Turing Machine by reading in a specification from a file.
 	 * The format of the .tm file is documented in README.
+	 * While the machine and its imports are read, files are cached by their
+	 * path and modification time, so a file imported several times is only
+	 * parsed once. The cache is cleared when the outermost call returns, so
+	 * reading the same file again later parses it again.
 	 *
 	 * @param filename	The file from which to read the machine
 	 * @param state_prefix	A prefix that should be prepended to all state names read
@@ -62,12 +250,24 @@ public:
 							Direction direction, std::string target);
 	
 	/**
-	 * Adds a jump as a construct of multiple rules. Goes as follows:
+	 * Add a rule of a machine with several tapes. The symbols and directions
+	 * are given for every tape, in the order of the tapes.
+	 *
+	 * @param origin			The alias of the origin state of the rule
+	 * @param reads				The symbols to read on the tapes
+	 * @param writes			The symbols to write onto the tapes
+	 * @param directions	The directions to move the heads to
+	 * @param target			The alias of the target state
+	 */
+	void addRule(std::string origin, const std::string& reads, const std::string& writes,
+							const std::vector<Direction>& directions, std::string target);
+
+	/**
+	 * Adds a jump rule. Goes as follows:
 	 * Read the symbol and overwrite it with the new one.
 	 * Then go to the direction until the stop symbol appears.
 	 * Halt one cell next to the stop symbol.
-	 * 
-	 * This only works if the tape alphabet is set.
+	 * Every cell the head moves over counts as one step.
 	 * 
 	 * @param origin		The alias of the origin state
 	 * @param readSymbol	The symbol to read on the tape
@@ -96,19 +296,74 @@ public:
 	
 	/**
 	 * Set the tape alphabet. It contains all the symbols the machine
-	 * may find on the tape and is used internally whenever rules
-	 * need to be constructed automatically.
+	 * may find on the tape.
 	 */
 	void setTapeAlphabet(std::vector<char>& tapeAlphabet);
+
+	/**
+	 * Set the number of tapes, which every rule reads and writes.
+	 * Only possible as long as the machine has no rules.
+	 *
+	 * @return false if the machine already has rules
+	 */
+	bool setTapes(unsigned tapes);
+
+	unsigned tapeCount() const {
+		return this->tapes;
+	}
 	
 	/**
 	 * Deletes all rules and states of the machine.
 	 */
 	void reset();
 	
+	/**
+	 * Remove the states the start state can not reach and merge states
+	 * that behave the same: states are merged if they are both final or
+	 * both not, and their rules read, write and move alike and lead to
+	 * states that are merged as well (partition refinement).
+	 * The start state and the first name of every merged group are kept.
+	 *
+	 * @return how many states were removed
+	 */
+	MinimizeResult minimize();
+
+	/**
+	 * Translate the machine into a flat transition table.
+	 * Compilation fails if there is no start state, if a state has
+	 * more than one rule for the same symbol or if the machine has
+	 * more than one tape.
+	 *
+	 * @param compiled	The object to store the result in
+	 *
+	 * @return true if the machine is deterministic and could be compiled
+	 */
+	bool compile(CompiledMachine* compiled) const;
+
+	/**
+	 * Translate the machine into a table that keeps every rule of a state
+	 * for the same symbol, to search it for accepting branches.
+	 *
+	 * @param compiled	The object to store the result in
+	 *
+	 * @return true if the machine could be compiled
+	 */
+	bool compile(NondeterministicMachine* compiled) const;
+
+	/**
+	 * Translate a machine with several tapes into a table with a row per
+	 * state and a column per tuple of symbols it may read.
+	 *
+	 * @param compiled	The object to store the result in
+	 *
+	 * @return true if the machine is deterministic and could be compiled
+	 */
+	bool compile(MultiTapeMachine* compiled) const;
+
 	/**
 	 * Run the machine on a given input.
-	 * Currently this works just for deterministic machines.
+	 * This works just for deterministic machines, see NondeterministicMachine
+	 * for the others.
 	 * 
 	 * @param tape			Pointer to the input tape
 	 * @param showDebug	Show the tape after each step
@@ -116,6 +371,16 @@ public:
 	 * @return true if program ended on a final state
 	 */
 	bool run(Tape* tape, bool showDebug = true);
+
+	/**
+	 * Run the machine on a given input, respecting the given limits.
+	 *
+	 * @param tape		Pointer to the input tape
+	 * @param options	Limits for the run
+	 *
+	 * @return why the machine stopped, along with statistics about the run
+	 */
+	RunResult run(Tape* tape, const RunOptions& options);
 	
 	/**
 	 * Run the machine on a given input; execute just one step at a time,
@@ -137,13 +402,31 @@ public:
 	 * The resulting file can be compiled with dot or its siblings.
 	 * GraphViz needs to be installed for compilation.
 	 *
+	 * With a profile, states and rules are labelled with the number of steps
+	 * spent in them and coloured from blue (cold) to red (hot).
+	 *
+	 * @param filename	Name of the file to output the graph into
+	 * @param profile		Optional profile of runs of the compiled machine
+	 *
+	 * @return true on success, false otherwise
+	 */
+	bool graph_to_file(std::string filename, const Profiler* profile = nullptr);
+
+	/**
+	 * Create a GraphViz file of the machine, showing as much of it as set in the
+	 * options. Imports are recognized by the prefixes of the names of their states;
+	 * rules that lead from one node to the same node are drawn as a single edge.
+	 *
 	 * @param filename	Name of the file to output the graph into
+	 * @param options		What to show
 	 *
 	 * @return true on success, false otherwise
 	 */
-	bool graph_to_file(std::string filename);
+	bool graph_to_file(std::string filename, const GraphOptions& options);
 };
 
 std::ostream& operator<<(std::ostream& stream, TuringMachine& tm);
 std::ostream& operator<<(std::ostream& stream,
 												const Direction& direction);
+std::ostream& operator<<(std::ostream& stream,
+												const HaltReason& reason);
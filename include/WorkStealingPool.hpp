@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * Runs a number of independent tasks on several threads.
+ *
+ * The tasks are numbered and every thread starts with an equal share of
+ * consecutive task numbers. A thread that runs out of work steals half of
+ * the remaining tasks of the busiest other thread, so a few long running
+ * tasks do not leave the other threads idle.
+ */
+class WorkStealingPool {
+
+private:
+
+	unsigned threads;
+
+public:
+
+	/**
+	 * @param threads	Number of threads to use, 0 for one per hardware thread
+	 */
+	WorkStealingPool(unsigned threads = 0);
+
+	/**
+	 * Call the task for every number in [0, count) and wait for all of them.
+	 * The task is called concurrently and must be thread safe.
+	 *
+	 * @param count		Number of tasks
+	 * @param task		Function to call with the number of each task
+	 */
+	void run(size_t count, const std::function<void(size_t)>& task) const;
+
+	/**
+	 * Like run(), but also tell the task which thread calls it, so every
+	 * thread can keep state of its own between tasks.
+	 *
+	 * @param count		Number of tasks
+	 * @param task		Function to call with the number of each task and the
+	 * 			number of the thread, which is below threadCount()
+	 */
+	void runOnThreads(size_t count, const std::function<void(size_t, unsigned)>& task) const;
+
+	/**
+	 * Get the number of threads the tasks are run on.
+	 */
+	unsigned threadCount() const {
+		return this->threads;
+	}
+};
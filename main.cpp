@@ -1,8 +1,19 @@
+#include <chrono>
 #include <iostream>
 #include <vector>
+#include <cstdlib>
 #include <cstring>
 #include "include/TuringMachine.hpp"
+#include "include/Checkpoint.hpp"
+#include "include/CompiledMachine.hpp"
+#include "include/Debugger.hpp"
+#include "include/MappedFile.hpp"
+#include "include/MultiTapeMachine.hpp"
+#include "include/NondeterministicMachine.hpp"
+#include "include/Profiler.hpp"
+#include "include/RunLengthTape.hpp"
 #include "include/Tape.hpp"
+#include "include/WorkStealingPool.hpp"
 
 using namespace std;
 
@@ -11,10 +22,211 @@ void printHelp() {
 	cout << "Invocation:" << endl;
 	cout << "  TuringMachine [options] machine.tm word ..." << endl;
 	cout << "Where machine.tm is a file that contains the Turing Machine and word ... is the words that should be run" << endl;
+	cout << "Instead of machine.tm, a machine.tmb file written by --compile-to can be given" << endl;
 	cout << "Possible options:" << endl;
 	cout << "  --visualize: Create an output file machine.dot which GraphViz code that represents the machine" << endl;
+	cout << "  --clusters: With --visualize, draw the states of every imported machine inside a box" << endl;
+	cout << "  --collapse-imports: With --visualize, draw every imported machine as a single node" << endl;
+	cout << "  --max-nodes N: With --visualize, only draw the N busiest states with --profile, or else the N nearest to the start" << endl;
 	cout << "  --batch: Don't show steps, only show whether the words got accepted" << endl;
 	cout << "  --interactive: Only skip from one state to the next on request" << endl;
+	cout << "  --debug: Stop before the first step and at breakpoints on states, rules, steps, the head and cells," << endl;
+	cout << "           running at full speed in between; type help when stopped to see the commands" << endl;
+	cout << "  --window CELLS: Show only this many cells on each side of the head" << endl;
+	cout << "  --show-every N: Show the tape only every N steps; with --interactive, run N steps at once" << endl;
+	cout << "  --max-fps N: Show the tape at most N times per second" << endl;
+	cout << "  --max-steps N: Stop a word after N steps" << endl;
+	cout << "  --max-cells N: Stop a word once its tape has grown beyond N cells" << endl;
+	cout << "  --timeout SECONDS: Stop a word after it ran for the given time" << endl;
+	cout << "  --stats: Show the number of steps, the tape size and the run time of each word" << endl;
+	cout << "  --detect-cycles: Stop words that provably run forever" << endl;
+	cout << "  --trace FILE: Record every step into FILE, or into FILE.1, FILE.2, ... for several words; see tmtrace" << endl;
+	cout << "  --checkpoint FILE: Save the run into FILE, or into FILE.1, FILE.2, ... for several words, to resume it later" << endl;
+	cout << "  --checkpoint-every SECONDS: Save the run this often, every 60 seconds by default" << endl;
+	cout << "  --resume FILE: Continue the run saved in FILE instead of running words, saving it into FILE again" << endl;
+	cout << "  --input-file FILE: Also run the words in FILE, one per line; a file of a single line is mapped" << endl;
+	cout << "                     into memory as the tape, so it may be as large as the tape can be" << endl;
+	cout << "  --output-tape FILE: Write the tape after the run into FILE, or into FILE.1, FILE.2, ... for several words," << endl;
+	cout << "                      without the empty cells at its ends" << endl;
+	cout << "  --profile: Count the steps spent in each state, rule and imported machine of all words and report them;" << endl;
+	cout << "             with --visualize, colour machine.dot by these counts" << endl;
+	cout << "  --nondeterministic: Allow several rules for the same state and symbol and search all branches" << endl;
+	cout << "                      for one that accepts; --jobs sets the threads, --max-steps the length of branches" << endl;
+	cout << "  --max-frontier N: Stop a search once more than N configurations wait to be explored" << endl;
+	cout << "  --max-memory MB: Stop a search once its configurations take more than MB megabytes" << endl;
+	cout << "  --rle: Store the tape as runs of equal symbols and cross whole runs at once" << endl;
+	cout << "  --jobs N: Run the words on N threads (0 for all cores); implies --batch" << endl;
+	cout << "  --minimize: Remove unreachable states and merge states that behave the same before running," << endl;
+	cout << "              visualizing or compiling the machine" << endl;
+	cout << "  --compile-to FILE: Save the compiled machine with all its imports into FILE, usually machine.tmb" << endl;
+}
+
+void printResult(const RunResult& result, bool stats) {
+	if (result.reason == HaltReason::CYCLE)
+		cout << "not accepted (" << result.reason << ")." << endl;
+	else if (result.reason != HaltReason::HALTED)
+		cout << "undecided (" << result.reason << ")." << endl;
+	else if (result.accepted)
+		cout << "accepted." << endl;
+	else
+		cout << "not accepted." << endl;
+
+	if (stats) {
+		cout << "  steps: " << result.steps << ", tape size: " << result.peakTapeSize
+			<< " cells, time: " << result.elapsed.count() << " s" << endl;
+	}
+}
+
+/* The file of a word, if there are several words */
+string wordFile(const string& filename, size_t word, size_t words) {
+	return words == 1 ? filename : filename + "." + to_string(word + 1);
+}
+
+/* Each word gets its own deadline, trace file and checkpoint file, and adds to the profile of the thread running it */
+RunOptions wordOptions(RunOptions options, double timeout, const string& traceFile, vector<Profiler>& profiles,
+											size_t word, size_t words, unsigned thread = 0) {
+	if (timeout > 0)
+		options.deadline = chrono::steady_clock::now()
+			+ chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(timeout));
+	if (!traceFile.empty())
+		options.traceFile = wordFile(traceFile, word, words);
+	if (!options.checkpointFile.empty())
+		options.checkpointFile = wordFile(options.checkpointFile, word, words);
+	if (!profiles.empty()) {
+		options.profile = &profiles[thread];
+		options.profile->restart();
+	}
+	return options;
+}
+
+/* Merge the profiles of all threads, report them and colour the graph of the machine with them */
+void reportProfile(const vector<Profiler>& profiles, TuringMachine& tm, const string& filename, bool visualize,
+									GraphOptions graph) {
+	if (profiles.empty()) {
+		if (visualize)
+			tm.graph_to_file(filename + ".dot", graph);
+		return;
+	}
+
+	Profiler profile = profiles[0];
+	for (size_t w = 1; w < profiles.size(); w++)
+		profile.merge(profiles[w]);
+	profile.report(cout);
+
+	if (visualize) {
+		graph.profile = &profile;
+		tm.graph_to_file(filename + ".dot", graph);
+	}
+}
+
+RunResult runWord(const CompiledMachine& machine, const string& word, const RunOptions& options, bool rle,
+								const string& outputTape) {
+	if (rle) {
+		RunLengthTape tape(word.c_str());
+		return machine.run(&tape, options);
+	}
+
+	/* Without anything looking at the cells, the symbols are packed into a few bits per cell */
+	if (!options.showDebug && !options.detectCycles && options.traceFile.empty() && options.profile == nullptr
+		&& options.checkpointFile.empty() && outputTape.empty())
+		return machine.runPacked(word.c_str(), options);
+
+	Tape tape(word.c_str());
+	RunResult result = machine.run(&tape, options);
+	if (!outputTape.empty())
+		tape.save(outputTape);
+	return result;
+}
+
+/* Split the words of a file into lines; a file of a single line is kept to be mapped as the tape */
+bool readInputFile(const string& filename, vector<string>& words, vector<string>& mappedWords) {
+	MappedFile file;
+	if (!file.open(filename))
+		return false;
+
+	const char* data = file.data();
+	size_t size = file.size();
+	if (size > 0 && data[size - 1] == '\n')
+		size--;
+	if (size == 0 || memchr(data, '\n', size) == nullptr) {
+		mappedWords.push_back(filename);
+		return true;
+	}
+
+	for (const char* line = data; line <= data + size;) {
+		const char* end = static_cast<const char*>(memchr(line, '\n', data + size - line));
+		if (end == nullptr)
+			end = data + size;
+		words.emplace_back(line, end);
+		line = end + 1;
+	}
+	return true;
+}
+
+/* Search every word for an accepting branch, showing its tape unless in batch mode */
+int searchWords(const TuringMachine& tm, const vector<string>& words, SearchOptions options,
+								double timeout, bool batch, bool stats) {
+	NondeterministicMachine machine;
+	if (!tm.compile(&machine))
+		return 1;
+
+	for (const string& word : words) {
+		cout << "'" << word << "' ... ";
+		if (timeout > 0)
+			options.deadline = chrono::steady_clock::now()
+				+ chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(timeout));
+
+		SearchResult result = machine.search(word.c_str(), options);
+		printResult(result, stats);
+		if (stats) {
+			cout << "  configurations: " << result.configurations << ", duplicates: " << result.duplicates
+				<< ", largest frontier: " << result.peakFrontier << endl;
+		}
+		if (!batch && result.accepted)
+			cout << result.tape << endl;
+	}
+	return 0;
+}
+
+/* Run a machine with several tapes on every word, which is put on its first tape */
+int runTapes(const TuringMachine& tm, const vector<string>& words, RunOptions options,
+						double timeout, bool stats, unsigned jobs) {
+	MultiTapeMachine machine;
+	if (!tm.compile(&machine))
+		return 1;
+
+	vector<Profiler> none;
+	auto runWord = [&](const string& word, const RunOptions& options) {
+		vector<Tape> tapes(1, Tape(word.c_str()));
+		tapes.resize(machine.tapeCount(), Tape(""));
+
+		vector<Tape*> pointers;
+		for (Tape& tape : tapes)
+			pointers.push_back(&tape);
+		return machine.run(pointers, options);
+	};
+
+	if (jobs != 1) {
+		vector<RunResult> results(words.size());
+		options.showDebug = false;
+
+		WorkStealingPool pool(jobs);
+		pool.run(words.size(), [&](size_t w) {
+			results[w] = runWord(words[w], wordOptions(options, timeout, "", none, w, words.size()));
+		});
+
+		for (size_t w = 0; w < words.size(); w++) {
+			cout << "'" << words[w] << "' ... ";
+			printResult(results[w], stats);
+		}
+		return 0;
+	}
+
+	for (size_t w = 0; w < words.size(); w++) {
+		cout << "'" << words[w] << "' ... ";
+		printResult(runWord(words[w], wordOptions(options, timeout, "", none, w, words.size())), stats);
+	}
+	return 0;
 }
 
 int main (int argc, char** argv) {
@@ -24,9 +236,15 @@ int main (int argc, char** argv) {
 		return 1;
 	}
 
-	string filename;
-	vector<string> words;
-	bool visualize = false, batch = false, interactive = false;
+	string filename, compileTo, traceFile, resumeFile, outputTape;
+	vector<string> words, inputFiles, mappedWords;
+	bool visualize = false, batch = false, interactive = false, stats = false, rle = false, profile = false;
+	bool nondeterministic = false, minimize = false, debug = false;
+	SearchOptions search;
+	GraphOptions graph;
+	RunOptions options;
+	double timeout = 0;
+	unsigned jobs = 1;
 
 	/* Iterate through options */
 	int i = 1;
@@ -36,14 +254,66 @@ int main (int argc, char** argv) {
 
 		if(strcmp(argv[i], "--visualize") == 0)
 			visualize = true;
+		else if(strcmp(argv[i], "--clusters") == 0)
+			graph.clusters = true;
+		else if(strcmp(argv[i], "--collapse-imports") == 0)
+			graph.collapseImports = true;
+		else if(i + 1 < argc && strcmp(argv[i], "--max-nodes") == 0)
+			graph.maxStates = strtoull(argv[++i], nullptr, 10);
 		else if(strcmp(argv[i], "--batch") == 0)
 			batch = true;
 		else if(strcmp(argv[i], "--interactive") == 0)
 			interactive = true;
+		else if(strcmp(argv[i], "--debug") == 0)
+			debug = true;
+		else if(strcmp(argv[i], "--stats") == 0)
+			stats = true;
+		else if(strcmp(argv[i], "--profile") == 0)
+			profile = true;
+		else if(strcmp(argv[i], "--minimize") == 0)
+			minimize = true;
+		else if(strcmp(argv[i], "--nondeterministic") == 0)
+			nondeterministic = true;
+		else if(i + 1 < argc && strcmp(argv[i], "--max-frontier") == 0)
+			search.maxFrontier = strtoull(argv[++i], nullptr, 10);
+		else if(i + 1 < argc && strcmp(argv[i], "--max-memory") == 0)
+			search.maxMemory = strtoull(argv[++i], nullptr, 10) << 20;
+		else if(strcmp(argv[i], "--rle") == 0)
+			rle = true;
+		else if(strcmp(argv[i], "--detect-cycles") == 0)
+			options.detectCycles = true;
+		else if(i + 1 < argc && strcmp(argv[i], "--max-steps") == 0)
+			options.maxSteps = strtoull(argv[++i], nullptr, 10);
+		else if(i + 1 < argc && strcmp(argv[i], "--max-cells") == 0)
+			options.maxTapeCells = strtoull(argv[++i], nullptr, 10);
+		else if(i + 1 < argc && strcmp(argv[i], "--timeout") == 0)
+			timeout = strtod(argv[++i], nullptr);
+		else if(i + 1 < argc && strcmp(argv[i], "--jobs") == 0)
+			jobs = strtoul(argv[++i], nullptr, 10);
+		else if(i + 1 < argc && strcmp(argv[i], "--window") == 0)
+			options.debugWindow = strtoull(argv[++i], nullptr, 10);
+		else if(i + 1 < argc && strcmp(argv[i], "--show-every") == 0)
+			options.debugInterval = strtoull(argv[++i], nullptr, 10);
+		else if(i + 1 < argc && strcmp(argv[i], "--max-fps") == 0)
+			options.debugFrameRate = strtod(argv[++i], nullptr);
+		else if(i + 1 < argc && strcmp(argv[i], "--trace") == 0)
+			traceFile = argv[++i];
+		else if(i + 1 < argc && strcmp(argv[i], "--checkpoint") == 0)
+			options.checkpointFile = argv[++i];
+		else if(i + 1 < argc && strcmp(argv[i], "--checkpoint-every") == 0)
+			options.checkpointInterval = strtod(argv[++i], nullptr);
+		else if(i + 1 < argc && strcmp(argv[i], "--resume") == 0)
+			resumeFile = argv[++i];
+		else if(i + 1 < argc && strcmp(argv[i], "--input-file") == 0)
+			inputFiles.push_back(argv[++i]);
+		else if(i + 1 < argc && strcmp(argv[i], "--output-tape") == 0)
+			outputTape = argv[++i];
+		else if(i + 1 < argc && strcmp(argv[i], "--compile-to") == 0)
+			compileTo = argv[++i];
 	}
 
 	/* Find filename and words */
-	if ((!visualize && i > argc - 2) || i > argc - 1) {
+	if ((!visualize && compileTo.empty() && resumeFile.empty() && inputFiles.empty() && i > argc - 2) || i > argc - 1) {
 		cout << "Expected filename and words after options" << endl;
 		printHelp();
 		return 1;
@@ -55,27 +325,195 @@ int main (int argc, char** argv) {
 		words.push_back(argv[i]);
 	}
 
-	/* Parse the Turing Machine */
-	TuringMachine tm = TuringMachine::create_from_file(filename);
+	for (const string& inputFile : inputFiles) {
+		if (!readInputFile(inputFile, words, mappedWords))
+			return 1;
+	}
+
+	/* Load a compiled machine as it is, or parse and compile the machine once, it is shared by all words */
+	CompiledMachine machine;
+	TuringMachine tm;
+	bool precompiled = filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".tmb") == 0;
+	if (precompiled) {
+		if (visualize || nondeterministic || minimize)
+			cout << "Compiled machines can not be visualized, searched or minimized, use the .tm file instead" << endl;
+		if (!machine.load(filename))
+			return 1;
+	} else {
+		tm = TuringMachine::create_from_file(filename);
+
+		if (minimize) {
+			MinimizeResult reduction = tm.minimize();
+			cout << "Minimized " << reduction.statesBefore << " states to " << reduction.statesAfter() << ": "
+				<< reduction.unreachable << " unreachable, " << reduction.merged << " merged" << endl;
+		}
+
+		/* Visualization; with a profile, the graph is created after the words ran */
+		if(visualize && !profile)
+			tm.graph_to_file(filename + ".dot", graph);
+
+		/* The other engines need the words of large files as strings */
+		if (tm.tapeCount() > 1 || nondeterministic) {
+			for (const string& mappedWord : mappedWords) {
+				MappedFile file;
+				if (!file.open(mappedWord))
+					return 1;
+				size_t size = file.size();
+				if (size > 0 && file.data()[size - 1] == '\n')
+					size--;
+				words.emplace_back(file.data(), size);
+			}
+			if (!outputTape.empty())
+				cout << "Only the tape of deterministic machines with a single tape is written" << endl;
+		}
+
+		/* Machines with several tapes have an engine of their own */
+		if (tm.tapeCount() > 1) {
+			if (nondeterministic || interactive || debug || rle || profile || options.detectCycles
+				|| !traceFile.empty() || !compileTo.empty() || !options.checkpointFile.empty() || !resumeFile.empty())
+				cout << "Machines with several tapes can only be run with the options for limits, stats, jobs and showing the tapes" << endl;
+			options.showDebug = !batch;
+			return runTapes(tm, words, options, timeout, stats, jobs);
+		}
 
-	/* Visualization */
-	if(visualize)
-		tm.graph_to_file(filename + ".dot");
+		/* Nondeterministic machines are searched instead of run */
+		if (nondeterministic) {
+			search.maxSteps = options.maxSteps;
+			search.maxTapeCells = options.maxTapeCells;
+			search.threads = jobs;
+			return searchWords(tm, words, search, timeout, batch, stats);
+		}
+
+		if(!tm.compile(&machine))
+			return 1;
+	}
+
+	if (!compileTo.empty() && !machine.save(compileTo))
+		return 1;
+
+	if (rle && (options.detectCycles || !traceFile.empty() || profile || !options.checkpointFile.empty()
+		|| !outputTape.empty()))
+		cout << "Cycles are not detected, no traces are recorded, no profiles are taken, no checkpoints are saved"
+			<< " and no tapes are written with --rle" << endl;
+
+	/* Continue a run on the tape saved in a checkpoint, which is mapped copy on write right from the file */
+	if (!resumeFile.empty()) {
+		if (rle || interactive || !traceFile.empty())
+			cout << "Checkpoints are resumed without --rle, --interactive and --trace" << endl;
+
+		Checkpoint checkpoint;
+		if (!checkpoint.open(resumeFile, machine))
+			return 1;
+		Tape tape("");
+		if (!checkpoint.restore(&tape))
+			return 1;
+
+		vector<Profiler> profiles;
+		if (profile)
+			profiles.assign(1, Profiler(machine));
+		if (options.checkpointFile.empty())
+			options.checkpointFile = resumeFile;
+		options.resume = &checkpoint;
+		options.showDebug = !batch;
+
+		cout << "'" << resumeFile << "' ... ";
+		printResult(machine.run(&tape, wordOptions(options, timeout, "", profiles, 0, 1)), stats);
+		if (!outputTape.empty())
+			tape.save(outputTape);
+		reportProfile(profiles, tm, filename, visualize && profile && !precompiled, graph);
+		return 0;
+	}
+
+	/* Every thread that runs words keeps a profile of its own, so words may run in parallel */
+	size_t total = words.size() + mappedWords.size();
+	vector<Profiler> profiles;
+	if (profile && !rle && !interactive && !debug)
+		profiles.assign(1, Profiler(machine));
+
+	/* The debugger keeps its breakpoints from one word to the next */
+	if (debug && (rle || interactive || profile || !traceFile.empty() || !options.checkpointFile.empty()))
+		cout << "No profiles are taken, no traces are recorded and no checkpoints are saved with --debug,"
+			<< " which runs on a plain tape" << endl;
+	Debugger debugger(machine, options);
+
+	/* The words of files with a single line run one after another on the tape mapped from the file */
+	auto runMappedWords = [&]() {
+		for (size_t f = 0; f < mappedWords.size(); f++) {
+			size_t w = words.size() + f;
+			cout << "'" << mappedWords[f] << "' ... ";
+			Tape tape("");
+			if (!tape.load(mappedWords[f]))
+				continue;
+
+			if (debug)
+				printResult(debugger.run(&tape), stats);
+			else if (interactive) {
+				if (machine.step(&tape, options))
+					cout << "accepted." << endl;
+				else
+					cout << "not accepted." << endl;
+			} else {
+				/* --jobs implies --batch for these words as well */
+				options.showDebug = !batch && jobs == 1;
+				printResult(machine.run(&tape, wordOptions(options, timeout, traceFile, profiles, w, total)), stats);
+			}
+
+			if (!outputTape.empty())
+				tape.save(wordFile(outputTape, w, total));
+		}
+	};
+
+	/* Execute the words in parallel, but report them in order */
+	if (jobs != 1 && !interactive && !debug) {
+		vector<RunResult> results(words.size());
+		options.showDebug = false;
+
+		WorkStealingPool pool(jobs);
+		if (!profiles.empty())
+			profiles.assign(pool.threadCount(), Profiler(machine));
+		pool.runOnThreads(words.size(), [&](size_t w, unsigned thread) {
+			results[w] = runWord(machine, words[w], wordOptions(options, timeout, traceFile, profiles, w, total, thread),
+				rle, outputTape.empty() ? "" : wordFile(outputTape, w, total));
+		});
+
+		for (size_t w = 0; w < words.size(); w++) {
+			cout << "'" << words[w] << "' ... ";
+			printResult(results[w], stats);
+		}
+		runMappedWords();
+		reportProfile(profiles, tm, filename, visualize && profile && !precompiled, graph);
+		return 0;
+	}
 
 	/* Execute on each word */
-	for(string word : words) {
-		Tape tape(word.c_str());
+	for (size_t w = 0; w < words.size(); w++) {
+		const string& word = words[w];
 		cout << "'" << word << "' ... ";
 
-		bool result;
-		if (interactive)
-			result = tm.step(&tape);
-		else
-			result = tm.run(&tape, !batch);
+		if (debug) {
+			Tape tape(word.c_str());
+			printResult(debugger.run(&tape), stats);
+			if (!outputTape.empty())
+				tape.save(wordFile(outputTape, w, total));
+			continue;
+		}
 
-		if (result)
-			cout << "accepted." << endl;
-		else
-			cout << "not accepted." << endl;
+		if (interactive) {
+			Tape tape(word.c_str());
+			if (machine.step(&tape, options))
+				cout << "accepted." << endl;
+			else
+				cout << "not accepted." << endl;
+			if (!outputTape.empty())
+				tape.save(wordFile(outputTape, w, total));
+			continue;
+		}
+
+		options.showDebug = !batch;
+		printResult(runWord(machine, word, wordOptions(options, timeout, traceFile, profiles, w, total), rle,
+			outputTape.empty() ? "" : wordFile(outputTape, w, total)), stats);
 	}
+	runMappedWords();
+
+	reportProfile(profiles, tm, filename, visualize && profile && !precompiled, graph);
 }
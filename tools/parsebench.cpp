@@ -0,0 +1,74 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "../include/TuringMachine.hpp"
+
+using namespace std;
+
+/*
+ * parsebench measures how fast machine files are read. It writes a large
+ * machine with all kinds of rules into a file and parses it a few times.
+ */
+
+void printHelp() {
+	cout << "Measure the speed of reading machine files" << endl;
+	cout << "Invocation:" << endl;
+	cout << "  parsebench [lines [file]]" << endl;
+	cout << "Writes a machine with the given number of lines (default 200000) into file" << endl;
+	cout << "(default parsebench.tm) and reports the best of three parses." << endl;
+}
+
+// write a machine that uses every form of rule, with many distinct states
+void writeMachine(const string& filename, unsigned long lines) {
+	ofstream out(filename, ios::trunc);
+	out << "# generated by parsebench\n";
+	out << "alphabet {0,1,_,x};\n";
+
+	for(unsigned long i = 0; i < lines; i++) {
+		unsigned long next = (i + 1) % lines;
+		switch(i % 5) {
+			case 0:
+			out << "State" << i << ": 0,1,R -> State" << next << "\n"; break;
+			case 1:
+			out << "State" << i << ",Other" << i << ": {0,1,_},L -> State" << next << " # a comment\n"; break;
+			case 2:
+			out << "State" << i << ": _,x,jump R until 1 -> State" << next << "\n"; break;
+			case 3:
+			out << "# State" << i << " is a final state\n";
+			out << "final State" << i << ";\n"; break;
+			default:
+			out << "State" << i << ": x,S -> State" << next << "\n"; break;
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	if(argc > 1 && argv[1][0] == '-') {
+		printHelp();
+		return 0;
+	}
+
+	unsigned long lines = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+	string filename = argc > 2 ? argv[2] : "parsebench.tm";
+
+	writeMachine(filename, lines);
+	ifstream file(filename, ios::binary | ios::ate);
+	double megabytes = file.tellg() / 1e6;
+
+	chrono::duration<double> best = chrono::duration<double>::max();
+	for(int round = 0; round < 3; round++) {
+		auto start = chrono::steady_clock::now();
+		TuringMachine tm = TuringMachine::create_from_file(filename);
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+		if(elapsed < best)
+			best = elapsed;
+	}
+
+	cout << filename << ": " << lines << " rule lines, " << megabytes << " MB" << endl;
+	cout << "  best parse: " << best.count() << " s, " << megabytes / best.count() << " MB/s, "
+			<< lines / best.count() << " lines/s" << endl;
+	return 0;
+}
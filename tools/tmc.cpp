@@ -0,0 +1,371 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../include/CompiledMachine.hpp"
+#include "../include/TuringMachine.hpp"
+
+using namespace std;
+
+/*
+ * tmc translates a Turing Machine into a C++ program that runs just this
+ * machine. Every state becomes a label with a switch over the symbol under
+ * the head and transitions are direct jumps to the label of the next state,
+ * so the compiler sees the whole machine instead of a table.
+ */
+
+void printHelp() {
+	cout << "Translate a Turing Machine into a C++ program" << endl;
+	cout << "Invocation:" << endl;
+	cout << "  tmc machine.tm output.cpp" << endl;
+	cout << "The generated program takes the words and the options of TuringMachine that limit, time and feed" << endl;
+	cout << "runs, without the machine file; see its --help." << endl;
+	cout << "It needs to be linked against the TuringMachine library." << endl;
+}
+
+// a C++ expression for a symbol
+string symbolLiteral(char symbol) {
+	if(symbol == '\'' || symbol == '\\')
+		return string("'\\") + symbol + "'";
+	if(symbol >= ' ' && symbol <= '~')
+		return string("'") + symbol + "'";
+	return "static_cast<char>(" + to_string(static_cast<int>(symbol)) + ")";
+}
+
+string label(uint32_t state) {
+	return "state_" + to_string(state);
+}
+
+// the code that moves the head for a transition
+string moveCode(const Transition& transition) {
+	if(transition.direction == Direction::LEFT)
+		return " tape->stepLeft();";
+	if(transition.direction == Direction::RIGHT)
+		return " tape->stepRight();";
+	return "";
+}
+
+// the states that can be reached from the start state, in the order they are found
+vector<uint32_t> reachableStates(const CompiledMachine& machine) {
+	vector<bool> seen(machine.stateCount(), false);
+	vector<uint32_t> order;
+	queue<uint32_t> toSearch;
+
+	toSearch.push(machine.startState());
+	seen[machine.startState()] = true;
+	while(!toSearch.empty()) {
+		uint32_t state = toSearch.front();
+		toSearch.pop();
+		order.push_back(state);
+
+		for(uint32_t symbol = 0; symbol < CompiledMachine::SYMBOLS; symbol++) {
+			const Transition& transition = machine.lookup(state, static_cast<char>(symbol));
+			if(transition.kind != TransitionKind::HALT && !seen[transition.target]) {
+				seen[transition.target] = true;
+				toSearch.push(transition.target);
+			}
+		}
+	}
+
+	return order;
+}
+
+void writeState(ostream& out, const CompiledMachine& machine, uint32_t state) {
+	out << label(state) << ": // " << machine.stateName(state) << "\n";
+
+	// scan states consist of a single scan and the rule for its stop symbol
+	const Transition* scan = nullptr;
+	for(uint32_t symbol = 0; symbol < CompiledMachine::SYMBOLS && scan == nullptr; symbol++) {
+		const Transition& transition = machine.lookup(state, static_cast<char>(symbol));
+		if(transition.kind == TransitionKind::SCAN)
+			scan = &transition;
+	}
+
+	if(scan != nullptr) {
+		const char* function = scan->direction == Direction::LEFT ? "scanLeft" : "scanRight";
+		out << "\tif(tape->getSymbol() != " << symbolLiteral(scan->stopSymbol) << ")\n";
+		out << "\t\tADVANCE(tape->" << function << "(" << symbolLiteral(scan->stopSymbol)
+				<< ", checkAt - steps), " << label(state) << ");\n";
+	}
+
+	out << "\tswitch(tape->getSymbol()) {\n";
+	for(uint32_t symbol = 0; symbol < CompiledMachine::SYMBOLS; symbol++) {
+		char c = static_cast<char>(symbol);
+		const Transition& transition = machine.lookup(state, c);
+		if(transition.kind == TransitionKind::HALT || transition.kind == TransitionKind::SCAN)
+			continue;
+
+		out << "\tcase " << symbolLiteral(c) << ":";
+		if(transition.kind == TransitionKind::SWEEP) {
+			const char* function = transition.direction == Direction::LEFT ? "sweepLeft" : "sweepRight";
+			out << " ADVANCE(tape->" << function << "(checkAt - steps), " << label(state) << ");\n";
+			continue;
+		}
+
+		if(transition.writeSymbol != c)
+			out << " tape->putSymbol(" << symbolLiteral(transition.writeSymbol) << ");";
+		out << moveCode(transition) << " ADVANCE(1, " << label(transition.target) << ");\n";
+	}
+	out << "\tdefault: result.accepted = " << (machine.isFinal(state) ? "true" : "false")
+			<< "; goto done;\n";
+	out << "\t}\n\n";
+}
+
+const char* PROLOGUE = R"CODE(#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Tape.hpp"
+#include "TuringMachine.hpp"
+#include "WorkStealingPool.hpp"
+
+using namespace std;
+
+// number of steps between two checks of the run limits
+#define CHECK_INTERVAL	4096
+
+// count the steps of a transition and continue in the next state
+#define ADVANCE(cells, next) \
+	do { \
+		steps += (cells); \
+		if(steps >= checkAt && (checkAt = checkLimits(tape, options, steps, result)) == 0) \
+			goto done; \
+		goto next; \
+	} while(0)
+
+// get the number of steps at which to check the limits next, or 0 to stop
+static uint64_t checkLimits(Tape* tape, const RunOptions& options, uint64_t steps, RunResult& result) {
+	if(options.maxSteps != 0 && steps >= options.maxSteps) {
+		result.reason = HaltReason::STEP_LIMIT;
+		return 0;
+	}
+	if(options.maxTapeCells != 0 && tape->length > options.maxTapeCells) {
+		result.reason = HaltReason::TAPE_LIMIT;
+		return 0;
+	}
+	if(options.deadline != chrono::steady_clock::time_point::max()
+		&& chrono::steady_clock::now() >= options.deadline) {
+		result.reason = HaltReason::TIMEOUT;
+		return 0;
+	}
+
+	uint64_t next = steps + CHECK_INTERVAL;
+	if(options.maxSteps != 0 && next > options.maxSteps)
+		next = options.maxSteps;
+	return next;
+}
+
+static RunResult runMachine(Tape* tape, const RunOptions& options) {
+	auto startTime = chrono::steady_clock::now();
+	RunResult result;
+	uint64_t steps = 0;
+	uint64_t checkAt = checkLimits(tape, options, steps, result);
+	if(checkAt == 0)
+		goto done;
+
+)CODE";
+
+const char* EPILOGUE = R"CODE(done:
+	result.steps = steps;
+	result.peakTapeSize = tape->length;
+	result.elapsed = chrono::steady_clock::now() - startTime;
+	return result;
+}
+
+void printHelp() {
+	cout << "Run a deterministic Turing Machine compiled from " << MACHINE_FILE << endl;
+	cout << "Invocation:" << endl;
+	cout << "  " << MACHINE_NAME << " [options] word ..." << endl;
+	cout << "Possible options:" << endl;
+	cout << "  --batch: Accepted for compatibility, steps are never shown" << endl;
+	cout << "  --max-steps N: Stop a word after N steps" << endl;
+	cout << "  --max-cells N: Stop a word once its tape has grown beyond N cells" << endl;
+	cout << "  --timeout SECONDS: Stop a word after it ran for the given time" << endl;
+	cout << "  --stats: Show the number of steps, the tape size and the run time of each word" << endl;
+	cout << "  --jobs N: Run the words on N threads (0 for all cores)" << endl;
+	cout << "  --input-file FILE: Also run the words in FILE, one per line; a file of a single line is mapped" << endl;
+	cout << "                     onto the tape instead of being read" << endl;
+	cout << "  --output-tape FILE: Write the tape after the run into FILE, or into FILE.1, FILE.2, ... for several words" << endl;
+	cout << "The other options of TuringMachine need the interpreter and are refused." << endl;
+}
+
+void printResult(const RunResult& result, bool stats) {
+	if (result.reason != HaltReason::HALTED)
+		cout << "undecided (" << result.reason << ")." << endl;
+	else if (result.accepted)
+		cout << "accepted." << endl;
+	else
+		cout << "not accepted." << endl;
+
+	if (stats) {
+		cout << "  steps: " << result.steps << ", tape size: " << result.peakTapeSize
+			<< " cells, time: " << result.elapsed.count() << " s" << endl;
+	}
+}
+
+/* The file of a word, if there are several words */
+string wordFile(const string& filename, size_t word, size_t words) {
+	return words == 1 ? filename : filename + "." + to_string(word + 1);
+}
+
+/* Split the words of a file into lines; a file of a single line is kept to be mapped as the tape */
+bool readInputFile(const string& filename, vector<string>& words, vector<string>& mappedWords) {
+	MappedFile file;
+	if (!file.open(filename))
+		return false;
+
+	const char* data = file.data();
+	size_t size = file.size();
+	if (size > 0 && data[size - 1] == '\n')
+		size--;
+	if (size == 0 || memchr(data, '\n', size) == nullptr) {
+		mappedWords.push_back(filename);
+		return true;
+	}
+
+	for (const char* line = data; line <= data + size;) {
+		const char* end = static_cast<const char*>(memchr(line, '\n', data + size - line));
+		if (end == nullptr)
+			end = data + size;
+		words.emplace_back(line, end);
+		line = end + 1;
+	}
+	return true;
+}
+
+RunOptions withDeadline(RunOptions options, double timeout) {
+	if (timeout > 0)
+		options.deadline = chrono::steady_clock::now()
+			+ chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(timeout));
+	return options;
+}
+
+int main (int argc, char** argv) {
+	vector<string> words, mappedWords;
+	bool stats = false;
+	RunOptions options;
+	double timeout = 0;
+	unsigned jobs = 1;
+	string outputTape;
+
+	/* Iterate through options; the ones that need the interpreter are refused rather than taken for words */
+	int i = 1;
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] != '-')
+			break;
+
+		if(strcmp(argv[i], "--help") == 0) {
+			printHelp();
+			return 0;
+		} else if(strcmp(argv[i], "--stats") == 0)
+			stats = true;
+		else if(strcmp(argv[i], "--batch") == 0)
+			continue;
+		else if(i + 1 < argc && strcmp(argv[i], "--max-steps") == 0)
+			options.maxSteps = strtoull(argv[++i], nullptr, 10);
+		else if(i + 1 < argc && strcmp(argv[i], "--max-cells") == 0)
+			options.maxTapeCells = strtoull(argv[++i], nullptr, 10);
+		else if(i + 1 < argc && strcmp(argv[i], "--timeout") == 0)
+			timeout = strtod(argv[++i], nullptr);
+		else if(i + 1 < argc && strcmp(argv[i], "--jobs") == 0)
+			jobs = strtoul(argv[++i], nullptr, 10);
+		else if(i + 1 < argc && strcmp(argv[i], "--input-file") == 0) {
+			if (!readInputFile(argv[++i], words, mappedWords))
+				return 1;
+		} else if(i + 1 < argc && strcmp(argv[i], "--output-tape") == 0)
+			outputTape = argv[++i];
+		else {
+			cout << "The option " << argv[i] << " is not supported by a machine compiled with tmc" << endl;
+			printHelp();
+			return 1;
+		}
+	}
+
+	/* The words of the command line come first, as with TuringMachine */
+	words.insert(words.begin(), argv + i, argv + argc);
+	size_t total = words.size() + mappedWords.size();
+
+	vector<RunResult> results(words.size());
+	WorkStealingPool pool(jobs);
+	pool.run(words.size(), [&](size_t w) {
+		Tape tape(words[w].c_str());
+		results[w] = runMachine(&tape, withDeadline(options, timeout));
+		if (!outputTape.empty())
+			tape.save(wordFile(outputTape, w, total));
+	});
+
+	for (size_t w = 0; w < words.size(); w++) {
+		cout << "'" << words[w] << "' ... ";
+		printResult(results[w], stats);
+	}
+
+	/* The words of files with a single line run one after another on the tape mapped from the file */
+	for (size_t f = 0; f < mappedWords.size(); f++) {
+		size_t w = words.size() + f;
+		cout << "'" << mappedWords[f] << "' ... ";
+		Tape tape("");
+		if (!tape.load(mappedWords[f]))
+			continue;
+
+		printResult(runMachine(&tape, withDeadline(options, timeout)), stats);
+		if (!outputTape.empty())
+			tape.save(wordFile(outputTape, w, total));
+	}
+}
+)CODE";
+
+// a C++ string literal for a text
+string stringLiteral(const string& text) {
+	string result = "\"";
+	for(char c : text) {
+		if(c == '"' || c == '\\')
+			result += '\\';
+		result += c;
+	}
+	return result + "\"";
+}
+
+int main(int argc, char** argv) {
+	if (argc != 3) {
+		cout << "Expected a machine file and an output file" << endl;
+		printHelp();
+		return 1;
+	}
+
+	string filename = argv[1], outputname = argv[2];
+
+	TuringMachine tm = TuringMachine::create_from_file(filename);
+	CompiledMachine machine;
+	if(!tm.compile(&machine))
+		return 1;
+
+	string name = filename.substr(filename.find_last_of('/') + 1);
+	name = name.substr(0, name.find_last_of('.'));
+
+	ostringstream out;
+	out << "// Generated by tmc from " << filename << ", do not edit.\n\n";
+	out << "#define MACHINE_FILE " << stringLiteral(filename) << "\n";
+	out << "#define MACHINE_NAME " << stringLiteral(name) << "\n\n";
+	out << PROLOGUE;
+	out << "\tgoto " << label(machine.startState()) << ";\n\n";
+	for(uint32_t state : reachableStates(machine))
+		writeState(out, machine, state);
+	out << EPILOGUE;
+
+	ofstream file(outputname, ios::trunc);
+	file << out.str();
+	if(!file) {
+		cout << "Unable to write '" << outputname << "'" << endl;
+		return 1;
+	}
+
+	return 0;
+}
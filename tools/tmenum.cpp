@@ -0,0 +1,470 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../include/CompiledMachine.hpp"
+#include "../include/Tape.hpp"
+#include "../include/TuringMachine.hpp"
+#include "../include/WorkStealingPool.hpp"
+
+using namespace std;
+
+/*
+ * tmenum enumerates all machines with a number of states and symbols in
+ * tree normal form, like in the search for busy beavers: every machine
+ * starts without rules and runs until it needs a rule it does not have.
+ * There, it is continued with every possible rule, where only the states
+ * used so far and the first unused one are targets, so machines that only
+ * differ in the names of their states are found once. The first rule is
+ * always 1RB, which leaves out the mirror images of all machines.
+ *
+ * Every machine that stops at a missing rule is counted as halting after
+ * one more step, as if that rule halted and wrote a 1.
+ */
+
+void printHelp() {
+	cout << "Enumerate all Turing Machines with some states and symbols and find the ones that run longest" << endl;
+	cout << "Invocation:" << endl;
+	cout << "  tmenum [options] states symbols" << endl;
+	cout << "Possible options:" << endl;
+	cout << "  --max-steps N: Consider machines that run for N steps as not halting (default 1000)" << endl;
+	cout << "  --jobs N: Run on N threads (default 0 for all cores)" << endl;
+	cout << "  --output FILE: Write every halting machine with its steps and score into FILE" << endl;
+	cout << "  --checkpoint FILE: Save the progress into FILE" << endl;
+	cout << "  --checkpoint-every SECONDS: Save the progress this often, every 60 seconds by default" << endl;
+	cout << "  --resume FILE: Continue the enumeration saved in FILE, saving it into FILE again" << endl;
+	cout << "Machines are written like 1RB1LB_1LA1RZ: the rules of the states A, B, ... for the symbols" << endl;
+	cout << "0, 1, ..., where 0 is the empty symbol, Z halts and --- is a rule that is never used." << endl;
+}
+
+// a rule that has been chosen for a machine
+struct Choice {
+	uint32_t state;
+	char symbol;
+	char writeSymbol;
+	Direction direction;
+	uint32_t target;
+};
+
+// a machine in the tree: its rules and the number of states they use
+struct Prefix {
+	vector<Choice> choices;
+	uint32_t usedStates;
+};
+
+// what has been found in a part of the tree
+struct Results {
+	uint64_t machines = 0, halting = 0, undecided = 0, skipped = 0;
+	uint64_t mostSteps = 0, bestScore = 0;
+	string mostStepsMachine, bestScoreMachine;
+	// the lines of the halting machines for --output
+	string output;
+
+	void merge(const Results& other) {
+		this->machines += other.machines;
+		this->halting += other.halting;
+		this->undecided += other.undecided;
+		this->skipped += other.skipped;
+		if(other.mostSteps > this->mostSteps) {
+			this->mostSteps = other.mostSteps;
+			this->mostStepsMachine = other.mostStepsMachine;
+		}
+		if(other.bestScore > this->bestScore) {
+			this->bestScore = other.bestScore;
+			this->bestScoreMachine = other.bestScoreMachine;
+		}
+	}
+};
+
+class Enumerator {
+
+private:
+
+	uint32_t states, symbols;
+	RunOptions options;
+	bool writeOutput;
+
+	// the symbol with the given number on the tape
+	static char symbolOf(uint32_t number) {
+		return number == 0 ? Tape::EMPTY_SYMBOL : static_cast<char>('0' + number);
+	}
+
+	static char digitOf(char symbol) {
+		return symbol == Tape::EMPTY_SYMBOL ? '0' : symbol;
+	}
+
+	// the machine in the usual notation, where the rule for the symbol at the halt halts
+	string notation(const CompiledMachine& machine, uint32_t haltState, char haltSymbol) const {
+		string result;
+		for(uint32_t state = 0; state < this->states; state++) {
+			if(state > 0)
+				result += '_';
+			for(uint32_t number = 0; number < this->symbols; number++) {
+				char symbol = symbolOf(number);
+				const Transition& transition = machine.lookup(state, symbol);
+				if(state == haltState && symbol == haltSymbol)
+					result += "1RZ";
+				else if(transition.kind == TransitionKind::HALT)
+					result += "---";
+				else {
+					result += digitOf(transition.writeSymbol);
+					result += transition.direction == Direction::LEFT ? 'L' : 'R';
+					result += machine.stateName(transition.target);
+				}
+			}
+		}
+		return result;
+	}
+
+	// a machine that moves onto an empty tape in the same state on an empty cell never comes back
+	static bool runsAway(const Tape& tape, uint32_t state, const Choice& choice) {
+		if(choice.symbol != Tape::EMPTY_SYMBOL || choice.target != state)
+			return false;
+
+		uint32_t first = choice.direction == Direction::RIGHT ? tape.currentPos + 1 : 0;
+		uint32_t last = choice.direction == Direction::RIGHT ? tape.length : tape.currentPos;
+		for(uint32_t i = first; i < last; i++) {
+			if(tape.data[i] != Tape::EMPTY_SYMBOL)
+				return false;
+		}
+		return true;
+	}
+
+public:
+
+	Enumerator(uint32_t states, uint32_t symbols, uint64_t maxSteps, bool writeOutput)
+		: states(states), symbols(symbols), writeOutput(writeOutput) {
+		this->options.maxSteps = maxSteps;
+	}
+
+	// the root of the tree: no rules but 1RB, if there is a state B
+	Prefix root() const {
+		Prefix prefix{{}, 1};
+		if(this->states > 1)
+			prefix.choices.push_back({0, Tape::EMPTY_SYMBOL, symbolOf(1), Direction::RIGHT, 1});
+		prefix.usedStates = this->states > 1 ? 2 : 1;
+		return prefix;
+	}
+
+	/**
+	 * Run the machine of a prefix and all machines below it in the tree.
+	 *
+	 * @param machine		The machine of the prefix, which is changed and restored
+	 * @param prefix		The rules of the machine, which are changed and restored
+	 * @param results		Where to count the machines
+	 * @param split			If not null, machines with this many rules are not run but collected here
+	 * @param splitDepth	The number of rules of the machines to collect
+	 */
+	void explore(CompiledMachine& machine, Prefix& prefix, Results& results,
+							vector<Prefix>* split = nullptr, size_t splitDepth = 0) const {
+		if(split != nullptr && prefix.choices.size() == splitDepth) {
+			split->push_back(prefix);
+			return;
+		}
+
+		Tape tape("");
+		RunResult run = machine.run(&tape, this->options);
+		results.machines++;
+		if(run.reason != HaltReason::HALTED) {
+			results.undecided++;
+			return;
+		}
+
+		// the rule the machine misses may be the one that halts
+		uint32_t state = run.state;
+		char symbol = tape.getSymbol();
+		uint64_t steps = run.steps + 1;
+		uint64_t score = symbol == Tape::EMPTY_SYMBOL ? 1 : 0;
+		for(uint32_t i = 0; i < tape.length; i++)
+			score += tape.data[i] != Tape::EMPTY_SYMBOL;
+
+		results.halting++;
+		if(steps > results.mostSteps || score > results.bestScore || this->writeOutput) {
+			string name = this->notation(machine, state, symbol);
+			if(steps > results.mostSteps) {
+				results.mostSteps = steps;
+				results.mostStepsMachine = name;
+			}
+			if(score > results.bestScore) {
+				results.bestScore = score;
+				results.bestScoreMachine = name;
+			}
+			if(this->writeOutput)
+				results.output += name + " " + to_string(steps) + " " + to_string(score) + "\n";
+		}
+
+		// the last missing rule has to halt
+		if(prefix.choices.size() + 1 == this->states * this->symbols)
+			return;
+
+		// continue with every rule, leading to the states used so far or the next one
+		uint32_t targets = min(prefix.usedStates + 1, this->states);
+		for(uint32_t target = 0; target < targets; target++) {
+			for(uint32_t write = 0; write < this->symbols; write++) {
+				for(Direction direction : {Direction::LEFT, Direction::RIGHT}) {
+					Choice choice = {state, symbol, symbolOf(write), direction, target};
+					if(runsAway(tape, state, choice)) {
+						results.skipped++;
+						continue;
+					}
+
+					uint32_t usedStates = prefix.usedStates;
+					prefix.usedStates = max(usedStates, target + 1);
+					prefix.choices.push_back(choice);
+					machine.setTransition(state, symbol, choice.writeSymbol, direction, target);
+
+					this->explore(machine, prefix, results, split, splitDepth);
+
+					prefix.choices.pop_back();
+					prefix.usedStates = usedStates;
+				}
+			}
+		}
+		machine.clearTransition(state, symbol);
+	}
+
+	// make the machine of a prefix
+	void build(CompiledMachine& machine, const Prefix& prefix) const {
+		machine.reset(this->states);
+		for(const Choice& choice : prefix.choices)
+			machine.setTransition(choice.state, choice.symbol, choice.writeSymbol, choice.direction, choice.target);
+	}
+};
+
+/*
+ * Progress files are plain text: the parameters of the enumeration, what has
+ * been found in the finished parts and which parts are finished.
+ */
+struct Progress {
+	uint32_t states = 0, symbols = 0;
+	uint64_t maxSteps = 0, depth = 0, parts = 0;
+	// the size of the output file when the progress was saved
+	uint64_t outputBytes = 0;
+	Results results;
+	// a byte per part instead of a bit, so checking a part does not race with marking another
+	vector<uint8_t> done;
+
+	bool save(const string& filename) const {
+		ostringstream text;
+		text << "tmenum 1\n";
+		text << "states " << this->states << " symbols " << this->symbols << " steps " << this->maxSteps
+				<< " depth " << this->depth << " parts " << this->parts << "\n";
+		text << "output " << this->outputBytes << "\n";
+		text << "machines " << this->results.machines << " halting " << this->results.halting
+				<< " undecided " << this->results.undecided << " skipped " << this->results.skipped << "\n";
+		text << "most-steps " << this->results.mostSteps << " " << this->results.mostStepsMachine << "\n";
+		text << "best-score " << this->results.bestScore << " " << this->results.bestScoreMachine << "\n";
+		text << "done ";
+		for(uint8_t part : this->done)
+			text << (part ? '1' : '0');
+		text << "\n";
+		string data = text.str();
+
+		// the old progress stays in place until the new one is on disk
+		string temporary = filename + ".tmp";
+		int descriptor = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(descriptor < 0)
+			return false;
+		bool written = write(descriptor, data.data(), data.size()) == static_cast<ssize_t>(data.size())
+			&& fsync(descriptor) == 0;
+		close(descriptor);
+		return written && rename(temporary.c_str(), filename.c_str()) == 0;
+	}
+
+	bool load(const string& filename) {
+		ifstream file(filename);
+		string word, version, done;
+		file >> word >> version;
+		if(!file || word != "tmenum" || version != "1") {
+			cout << "'" << filename << "' is not the progress of tmenum" << endl;
+			return false;
+		}
+
+		file >> word >> this->states >> word >> this->symbols >> word >> this->maxSteps
+				>> word >> this->depth >> word >> this->parts;
+		file >> word >> this->outputBytes;
+		file >> word >> this->results.machines >> word >> this->results.halting
+				>> word >> this->results.undecided >> word >> this->results.skipped;
+		// the name after the number is empty as long as no machine halted, so only its space is skipped
+		file >> word >> this->results.mostSteps;
+		getline(file.ignore(1), this->results.mostStepsMachine);
+		file >> word >> this->results.bestScore;
+		getline(file.ignore(1), this->results.bestScoreMachine);
+		file >> word >> done;
+		if(!file || done.size() != this->parts) {
+			cout << "'" << filename << "' is damaged" << endl;
+			return false;
+		}
+
+		this->done.clear();
+		for(char part : done)
+			this->done.push_back(part == '1');
+		return true;
+	}
+};
+
+int main(int argc, char** argv) {
+	uint64_t maxSteps = 1000;
+	unsigned jobs = 0;
+	string outputFile, checkpointFile, resumeFile;
+	double checkpointInterval = 60;
+
+	vector<const char*> numbers;
+	for(int i = 1; i < argc; i++) {
+		if(argv[i][0] != '-')
+			numbers.push_back(argv[i]);
+		else if(strcmp(argv[i], "--help") == 0) {
+			printHelp();
+			return 0;
+		} else if(i + 1 < argc && strcmp(argv[i], "--max-steps") == 0)
+			maxSteps = strtoull(argv[++i], nullptr, 10);
+		else if(i + 1 < argc && strcmp(argv[i], "--jobs") == 0)
+			jobs = strtoul(argv[++i], nullptr, 10);
+		else if(i + 1 < argc && strcmp(argv[i], "--output") == 0)
+			outputFile = argv[++i];
+		else if(i + 1 < argc && strcmp(argv[i], "--checkpoint") == 0)
+			checkpointFile = argv[++i];
+		else if(i + 1 < argc && strcmp(argv[i], "--checkpoint-every") == 0)
+			checkpointInterval = strtod(argv[++i], nullptr);
+		else if(i + 1 < argc && strcmp(argv[i], "--resume") == 0)
+			resumeFile = argv[++i];
+	}
+
+	Progress progress;
+	if(!resumeFile.empty()) {
+		if(!progress.load(resumeFile))
+			return 1;
+		if(checkpointFile.empty())
+			checkpointFile = resumeFile;
+		if(maxSteps != progress.maxSteps && maxSteps != 1000)
+			cout << "Continuing with the step limit of '" << resumeFile << "', " << progress.maxSteps << endl;
+		maxSteps = progress.maxSteps;
+	} else if(numbers.size() == 2) {
+		progress.states = strtoul(numbers[0], nullptr, 10);
+		progress.symbols = strtoul(numbers[1], nullptr, 10);
+		progress.maxSteps = maxSteps;
+	} else {
+		cout << "Expected the number of states and symbols" << endl;
+		printHelp();
+		return 1;
+	}
+
+	// the symbols are the empty one and the digits
+	if(progress.states < 1 || progress.states > 26 || progress.symbols < 2 || progress.symbols > 10) {
+		cout << "Machines need 1 to 26 states and 2 to 10 symbols" << endl;
+		return 1;
+	}
+
+	auto startTime = chrono::steady_clock::now();
+	Enumerator enumerator(progress.states, progress.symbols, maxSteps, !outputFile.empty());
+
+	// split the top of the tree into enough parts for the threads to share
+	WorkStealingPool pool(jobs);
+	size_t wanted = 64 * max(1u, jobs == 0 ? thread::hardware_concurrency() : jobs);
+	vector<Prefix> parts;
+	Results top;
+	Prefix root = enumerator.root();
+	for(size_t depth = root.choices.size() + 1; ; depth++) {
+		CompiledMachine machine;
+		enumerator.build(machine, root);
+		parts.clear();
+		top = Results();
+		enumerator.explore(machine, root, top, &parts, depth);
+
+		// a resumed enumeration is split just like before
+		bool enough = parts.size() >= wanted || depth + 1 >= progress.states * progress.symbols;
+		if(resumeFile.empty() ? enough : depth >= progress.depth) {
+			if(resumeFile.empty()) {
+				progress.depth = depth;
+				progress.parts = parts.size();
+				progress.done.assign(parts.size(), 0);
+			}
+			break;
+		}
+	}
+
+	if(progress.parts != parts.size()) {
+		cout << "'" << resumeFile << "' does not belong to these machines" << endl;
+		return 1;
+	}
+
+	// the output holds the finished parts only; a part that was written but not saved is written again
+	ofstream output;
+	if(!outputFile.empty()) {
+		if(resumeFile.empty()) {
+			output.open(outputFile, ios::trunc);
+			output << top.output << flush;
+		} else {
+			if(truncate(outputFile.c_str(), progress.outputBytes) != 0) {
+				cout << "Unable to continue '" << outputFile << "'" << endl;
+				return 1;
+			}
+			output.open(outputFile, ios::app);
+		}
+		if(!output) {
+			cout << "Unable to write '" << outputFile << "'" << endl;
+			return 1;
+		}
+		progress.outputBytes = output.tellp();
+	}
+
+	// the top of the tree is run again on every start and never saved
+	Results saved = progress.results;
+	auto interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(checkpointInterval));
+	auto nextSave = chrono::steady_clock::now() + interval;
+	mutex lock;
+
+	pool.run(parts.size(), [&](size_t part) {
+		if(progress.done[part])
+			return;
+
+		CompiledMachine machine;
+		Prefix prefix = parts[part];
+		enumerator.build(machine, prefix);
+		Results results;
+		enumerator.explore(machine, prefix, results);
+
+		lock_guard<mutex> guard(lock);
+		progress.results.merge(results);
+		progress.done[part] = 1;
+		if(output.is_open()) {
+			output << results.output << flush;
+			progress.outputBytes = output.tellp();
+		}
+		if(!checkpointFile.empty() && chrono::steady_clock::now() >= nextSave) {
+			if(!progress.save(checkpointFile))
+				cout << "Unable to write '" << checkpointFile << "'" << endl;
+			nextSave = chrono::steady_clock::now() + interval;
+		}
+	});
+
+	if(!checkpointFile.empty() && !progress.save(checkpointFile)) {
+		cout << "Unable to write '" << checkpointFile << "'" << endl;
+		return 1;
+	}
+
+	Results total = progress.results;
+	total.merge(top);
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+	uint64_t runNow = total.machines - saved.machines;
+
+	cout << "machines: " << total.machines << ", halting: " << total.halting << ", undecided after "
+			<< maxSteps << " steps: " << total.undecided << ", never halting: " << total.skipped << endl;
+	cout << "most steps: " << total.mostSteps << " by " << total.mostStepsMachine << endl;
+	cout << "best score: " << total.bestScore << " by " << total.bestScoreMachine << endl;
+	cout << "time: " << elapsed.count() << " s, " << (elapsed.count() > 0 ? runNow / elapsed.count() : 0)
+			<< " machines per second" << endl;
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../include/Tape.hpp"
+#include "../include/TraceRecorder.hpp"
+
+using namespace std;
+
+/*
+ * tmtrace shows traces recorded with TuringMachine --trace. The steps are
+ * replayed on a tape, and only the requested ones are shown, so any part of
+ * a long run can be looked at quickly.
+ */
+
+void printHelp() {
+	cout << "Show a trace recorded with TuringMachine --trace" << endl;
+	cout << "Invocation:" << endl;
+	cout << "  tmtrace trace [first [last]]" << endl;
+	cout << "Without a range, a summary of the run is shown. Otherwise the tape and the state" << endl;
+	cout << "after each step from first to last are shown, where step 0 is the start." << endl;
+}
+
+// apply a step of the trace to the tape
+void replay(Tape* tape, const TraceStep& step) {
+	tape->putSymbol(step.writeSymbol);
+	if(step.direction == Direction::LEFT)
+		tape->stepLeft();
+	else if(step.direction == Direction::RIGHT)
+		tape->stepRight();
+}
+
+void show(const Trace& trace, const Tape& tape, uint64_t step, uint32_t state) {
+	cout << "Step " << step << ", state " << trace.stateName(state) << endl;
+	cout << tape << endl;
+}
+
+int main(int argc, char** argv) {
+	if(argc < 2 || argc > 4 || argv[1][0] == '-') {
+		printHelp();
+		return argc < 2 ? 1 : 0;
+	}
+
+	Trace trace;
+	if(!trace.open(argv[1]))
+		return 1;
+
+	string cells(trace.startTape());
+	Tape tape(cells.data(), cells.size(), trace.startHead());
+	uint32_t state = trace.startState();
+
+	if(argc == 2) {
+		// summary of the whole run
+		int64_t head = 0, leftmost = 0, rightmost = 0;
+		for(uint64_t i = 0; i < trace.stepCount(); i++) {
+			TraceStep step = trace.step(i);
+			if(step.direction == Direction::LEFT)
+				head--;
+			else if(step.direction == Direction::RIGHT)
+				head++;
+			leftmost = min(leftmost, head);
+			rightmost = max(rightmost, head);
+			state = step.state;
+		}
+
+		cout << "steps: " << trace.stepCount() << endl;
+		cout << "states: " << trace.stateCount() << endl;
+		cout << "start state: " << trace.stateName(trace.startState()) << endl;
+		cout << "last state: " << trace.stateName(state) << endl;
+		cout << "head positions: " << leftmost << " to " << rightmost << " relative to the start" << endl;
+		return 0;
+	}
+
+	uint64_t first = strtoull(argv[2], nullptr, 10);
+	uint64_t last = argc > 3 ? strtoull(argv[3], nullptr, 10) : first;
+	if(first > trace.stepCount() || last < first) {
+		cout << "The trace has steps 0 to " << trace.stepCount() << endl;
+		return 1;
+	}
+	last = min(last, trace.stepCount());
+
+	// get to the first step without showing anything
+	for(uint64_t i = 0; i < first; i++) {
+		TraceStep step = trace.step(i);
+		replay(&tape, step);
+		state = step.state;
+	}
+
+	show(trace, tape, first, state);
+	for(uint64_t i = first; i < last; i++) {
+		TraceStep step = trace.step(i);
+		replay(&tape, step);
+		state = step.state;
+		show(trace, tape, i + 1, state);
+	}
+
+	return 0;
+}